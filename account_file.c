@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <string.h>
+#include "account_file.h"
+
+void initHeader(struct FileHeader *header) {
+    memset(header, 0, sizeof(struct FileHeader));
+    memcpy(header->magic, ACCOUNT_FILE_MAGIC, sizeof(header->magic));
+    header->version = ACCOUNT_LAYOUT_VERSION;
+    header->recordSize = ACCOUNT_RECORD_SIZE;
+}
+
+// Reads the header at the start of the file and leaves the stream positioned
+// at the first record. Returns 1 if the header describes the current layout.
+int readHeader(FILE *file, struct FileHeader *header) {
+    if (fseek(file, 0, SEEK_SET) != 0) {
+        return 0;
+    }
+    if (fread(header, sizeof(struct FileHeader), 1, file) != 1) {
+        return 0;
+    }
+
+    return memcmp(header->magic, ACCOUNT_FILE_MAGIC, sizeof(header->magic)) == 0
+        && header->version == ACCOUNT_LAYOUT_VERSION
+        && header->recordSize == ACCOUNT_RECORD_SIZE;
+}
+
+// Rewrites the header in place. The stream position is left just after it.
+int writeHeader(FILE *file, const struct FileHeader *header) {
+    if (fseek(file, 0, SEEK_SET) != 0) {
+        return 0;
+    }
+    if (fwrite(header, sizeof(struct FileHeader), 1, file) != 1) {
+        return 0;
+    }
+    return fflush(file) == 0;
+}
+
+// Opens an existing account file and validates its header. Returns NULL if
+// the file is missing or was written by an older build.
+FILE *openAccountFile(const char *path, int writable, struct FileHeader *header) {
+    FILE *file = fopen(path, writable ? "r+b" : "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (!readHeader(file, header)) {
+        printf("%s has an unsupported layout. Convert it with migrate_accounts first.\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+// Writes the header of an empty account file to a stream the caller has
+// just opened for writing, e.g. after configuring its buffering.
+int initAccountFile(FILE *file, struct FileHeader *header) {
+    initHeader(header);
+    return writeHeader(file, header);
+}
+
+// Creates an empty account file containing only a header.
+FILE *createAccountFile(const char *path, struct FileHeader *header) {
+    FILE *file = fopen(path, "w+b");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (!initAccountFile(file, header)) {
+        fclose(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+// File offset of the record at index.
+long recordOffset(long index) {
+    return (long)sizeof(struct FileHeader) + index * (long)sizeof(struct Account);
+}
+
+// FNV-1a over the raw record. The file checksum is the sum of these, so a
+// single record update adjusts it without rescanning the file.
+uint32_t recordChecksum(const struct Account *acc) {
+    const unsigned char *bytes = (const unsigned char *)acc;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < sizeof(struct Account); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// FNV-1a over an account number, for the in-memory tables keyed by account.
+uint32_t hashAccount(const char *accountNumber) {
+    uint32_t hash = 2166136261u;
+    for (; *accountNumber; accountNumber++) {
+        hash ^= (unsigned char)*accountNumber;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Full scan that checks the header's record count and checksum against the
+// records actually present. Returns 1 if they agree.
+int verifyAccountFile(const char *path) {
+    struct FileHeader header;
+    struct Account acc;
+    uint32_t count = 0;
+    uint32_t checksum = 0;
+
+    FILE *file = openAccountFile(path, 0, &header);
+    if (file == NULL) {
+        return 0;
+    }
+
+    while (fread(&acc, sizeof(struct Account), 1, file)) {
+        count++;
+        checksum += recordChecksum(&acc);
+    }
+    fclose(file);
+
+    if (count != header.recordCount) {
+        printf("%s: header says %u records, found %u\n", path, header.recordCount, count);
+        return 0;
+    }
+    if (checksum != header.checksum) {
+        printf("%s: checksum mismatch (header %08x, records %08x)\n", path, header.checksum, checksum);
+        return 0;
+    }
+
+    return 1;
+}
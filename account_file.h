@@ -0,0 +1,56 @@
+#ifndef ACCOUNT_FILE_H
+#define ACCOUNT_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define FILE_NAME "accounts.txt"
+
+// On-disk layout of FILE_NAME:
+//   [FileHeader: 64 bytes][Account: 64 bytes] * recordCount
+// All integers are fixed width with no compiler padding, so the Linux and
+// Windows builds (both little-endian) read and write the same bytes. Every
+// record starts on a 64-byte file offset, which keeps one account per cache
+// line once the file is mapped or read into an aligned buffer.
+#define ACCOUNT_FILE_MAGIC "ATMA"
+#define ACCOUNT_LAYOUT_VERSION 1
+#define ACCOUNT_RECORD_SIZE 64
+
+// Balances are whole cents. Unused bytes must stay zero so that records
+// compare and checksum byte for byte.
+struct Account {
+    char accountNumber[20];      // offset 0, NUL padded
+    char pin[10];                // offset 20, NUL padded
+    uint8_t rateTier;            // offset 30, see interest.h
+    uint8_t reserved0;           // offset 31
+    int32_t failedLoginAttempts; // offset 32
+    uint32_t lastAccrualTime;    // offset 36, seconds since the epoch, 0 = not started
+    int64_t checkingBalance;     // offset 40, cents
+    int64_t savingsBalance;      // offset 48, cents
+    int64_t lastLoginTime;       // offset 56, seconds since the epoch
+};
+
+struct FileHeader {
+    char magic[4];               // ACCOUNT_FILE_MAGIC, not NUL terminated
+    uint32_t version;            // ACCOUNT_LAYOUT_VERSION
+    uint32_t recordSize;         // ACCOUNT_RECORD_SIZE
+    uint32_t recordCount;
+    uint32_t checksum;           // sum of recordChecksum() over all records
+    uint8_t reserved[44];
+};
+
+_Static_assert(sizeof(struct Account) == ACCOUNT_RECORD_SIZE, "Account must be one 64-byte record");
+_Static_assert(sizeof(struct FileHeader) == ACCOUNT_RECORD_SIZE, "FileHeader must be 64 bytes");
+
+void initHeader(struct FileHeader *header);
+int readHeader(FILE *file, struct FileHeader *header);
+int writeHeader(FILE *file, const struct FileHeader *header);
+FILE *openAccountFile(const char *path, int writable, struct FileHeader *header);
+int initAccountFile(FILE *file, struct FileHeader *header);
+FILE *createAccountFile(const char *path, struct FileHeader *header);
+long recordOffset(long index);
+uint32_t recordChecksum(const struct Account *acc);
+uint32_t hashAccount(const char *accountNumber);
+int verifyAccountFile(const char *path);
+
+#endif
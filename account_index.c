@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "account_index.h"
+#include "account_scan.h"
+
+#define INITIAL_BUCKETS 256
+
+static int compareEntries(const struct IndexEntry *a, const struct IndexEntry *b) {
+    if (a->key != b->key) {
+        return a->key < b->key ? -1 : 1;
+    }
+    return strncmp(a->accountNumber, b->accountNumber, sizeof(a->accountNumber));
+}
+
+static struct IndexNode *newNode(int leaf) {
+    struct IndexNode *node = calloc(1, sizeof(struct IndexNode));
+    if (node != NULL) {
+        node->leaf = leaf;
+    }
+    return node;
+}
+
+// Index of the child of an internal node that may hold entry.
+static int childFor(const struct IndexNode *node, const struct IndexEntry *entry) {
+    int i = 0;
+    while (i < node->count && compareEntries(&node->entries[i], entry) <= 0) {
+        i++;
+    }
+    return i;
+}
+
+// Inserts into the subtree. If the node overflows it is split, the new right
+// sibling is returned through split and its first key through separator.
+// A node one entry short of full allocates its sibling before anything
+// changes, so running out of memory returns 0 with the subtree untouched.
+static int insertInto(struct IndexNode *node, const struct IndexEntry *entry,
+                      struct IndexNode **split, struct IndexEntry *separator) {
+    struct IndexNode *right = NULL;
+
+    *split = NULL;
+    if (node->count == INDEX_ORDER - 1 && (right = newNode(node->leaf)) == NULL) {
+        return 0;
+    }
+
+    if (node->leaf) {
+        int pos = 0;
+        while (pos < node->count && compareEntries(&node->entries[pos], entry) < 0) {
+            pos++;
+        }
+        memmove(&node->entries[pos + 1], &node->entries[pos], (node->count - pos) * sizeof(struct IndexEntry));
+        node->entries[pos] = *entry;
+        node->count++;
+
+        if (node->count == INDEX_ORDER) {
+            int keep = INDEX_ORDER / 2;
+            right->count = node->count - keep;
+            memcpy(right->entries, &node->entries[keep], right->count * sizeof(struct IndexEntry));
+            node->count = keep;
+
+            right->next = node->next;
+            right->prev = node;
+            if (node->next != NULL) {
+                node->next->prev = right;
+            }
+            node->next = right;
+
+            *split = right;
+            *separator = right->entries[0];
+        }
+        return 1;
+    }
+
+    int i = childFor(node, entry);
+    struct IndexNode *childSplit;
+    struct IndexEntry childSeparator;
+    if (!insertInto(node->children[i], entry, &childSplit, &childSeparator)) {
+        free(right);
+        return 0;
+    }
+    if (childSplit == NULL) {
+        free(right);
+        return 1;
+    }
+
+    memmove(&node->entries[i + 1], &node->entries[i], (node->count - i) * sizeof(struct IndexEntry));
+    memmove(&node->children[i + 2], &node->children[i + 1], (node->count - i) * sizeof(struct IndexNode *));
+    node->entries[i] = childSeparator;
+    node->children[i + 1] = childSplit;
+    node->count++;
+
+    if (node->count == INDEX_ORDER) {
+        int mid = INDEX_ORDER / 2;
+        right->count = node->count - mid - 1;
+        memcpy(right->entries, &node->entries[mid + 1], right->count * sizeof(struct IndexEntry));
+        memcpy(right->children, &node->children[mid + 1], (right->count + 1) * sizeof(struct IndexNode *));
+        node->count = mid;
+
+        *split = right;
+        *separator = node->entries[mid];
+    }
+    return 1;
+}
+
+// Returns 0 if out of memory, in which case the tree is unchanged.
+int btreeInsert(struct BTree *tree, int64_t key, const char *accountNumber) {
+    struct IndexEntry entry;
+    struct IndexNode *split;
+    struct IndexEntry separator;
+    struct IndexNode *root = NULL;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    strncpy(entry.accountNumber, accountNumber, sizeof(entry.accountNumber) - 1);
+
+    if (tree->root == NULL && (tree->root = newNode(1)) == NULL) {
+        return 0;
+    }
+    if (tree->root->count == INDEX_ORDER - 1 && (root = newNode(0)) == NULL) {
+        return 0;
+    }
+
+    if (!insertInto(tree->root, &entry, &split, &separator)) {
+        free(root);
+        return 0;
+    }
+    if (split == NULL) {
+        free(root);
+    } else {
+        root->count = 1;
+        root->entries[0] = separator;
+        root->children[0] = tree->root;
+        root->children[1] = split;
+        tree->root = root;
+    }
+    tree->size++;
+    return 1;
+}
+
+// Removes the entry from its leaf. Nodes are not merged when they become
+// sparse; separators stay valid bounds, so lookups remain logarithmic in the
+// largest size the tree has reached and scans skip empty leaves.
+int btreeRemove(struct BTree *tree, int64_t key, const char *accountNumber) {
+    struct IndexEntry entry;
+    struct IndexNode *node = tree->root;
+
+    if (node == NULL) {
+        return 0;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    strncpy(entry.accountNumber, accountNumber, sizeof(entry.accountNumber) - 1);
+
+    while (!node->leaf) {
+        node = node->children[childFor(node, &entry)];
+    }
+
+    for (int i = 0; i < node->count; i++) {
+        if (compareEntries(&node->entries[i], &entry) == 0) {
+            memmove(&node->entries[i], &node->entries[i + 1], (node->count - i - 1) * sizeof(struct IndexEntry));
+            node->count--;
+            tree->size--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Visits entries with key >= from in ascending order.
+void btreeScanFrom(const struct BTree *tree, int64_t from, IndexVisitor visit, void *context) {
+    struct IndexEntry start;
+    struct IndexNode *node = tree->root;
+
+    if (node == NULL) {
+        return;
+    }
+
+    memset(&start, 0, sizeof(start));
+    start.key = from;
+    while (!node->leaf) {
+        node = node->children[childFor(node, &start)];
+    }
+
+    int i = 0;
+    while (i < node->count && compareEntries(&node->entries[i], &start) < 0) {
+        i++;
+    }
+
+    for (; node != NULL; node = node->next, i = 0) {
+        for (; i < node->count; i++) {
+            if (!visit(&node->entries[i], context)) {
+                return;
+            }
+        }
+    }
+}
+
+// Visits every entry in descending order.
+void btreeScanDescending(const struct BTree *tree, IndexVisitor visit, void *context) {
+    struct IndexNode *node = tree->root;
+
+    if (node == NULL) {
+        return;
+    }
+    while (!node->leaf) {
+        node = node->children[node->count];
+    }
+
+    for (; node != NULL; node = node->prev) {
+        for (int i = node->count - 1; i >= 0; i--) {
+            if (!visit(&node->entries[i], context)) {
+                return;
+            }
+        }
+    }
+}
+
+static void freeNode(struct IndexNode *node) {
+    if (!node->leaf) {
+        for (int i = 0; i <= node->count; i++) {
+            freeNode(node->children[i]);
+        }
+    }
+    free(node);
+}
+
+void btreeFree(struct BTree *tree) {
+    if (tree->root != NULL) {
+        freeNode(tree->root);
+    }
+    tree->root = NULL;
+    tree->size = 0;
+}
+
+// Link to the account's entry in its hash chain, or to the NULL ending the
+// chain if the account is not indexed.
+static struct IndexedAccount **indexedLink(struct AccountIndexes *indexes, const char *accountNumber) {
+    struct IndexedAccount **link = &indexes->accounts[hashAccount(accountNumber) & (indexes->bucketCount - 1)];
+
+    while (*link != NULL && strcmp((*link)->accountNumber, accountNumber) != 0) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+static void growIndexedAccounts(struct AccountIndexes *indexes) {
+    int newCount = indexes->bucketCount * 2;
+    struct IndexedAccount **newBuckets = calloc(newCount, sizeof(struct IndexedAccount *));
+    if (newBuckets == NULL) {
+        return; // longer chains still work
+    }
+
+    for (int i = 0; i < indexes->bucketCount; i++) {
+        struct IndexedAccount *entry = indexes->accounts[i];
+        while (entry != NULL) {
+            struct IndexedAccount *next = entry->next;
+            uint32_t b = hashAccount(entry->accountNumber) & (newCount - 1);
+            entry->next = newBuckets[b];
+            newBuckets[b] = entry;
+            entry = next;
+        }
+    }
+
+    free(indexes->accounts);
+    indexes->accounts = newBuckets;
+    indexes->bucketCount = newCount;
+}
+
+// Replaces whatever keys the account is indexed under with after's, or
+// drops the account if after is NULL. Returns 0 if out of memory or if the
+// trees did not hold the remembered keys.
+static int indexAccount(struct AccountIndexes *indexes, const char *accountNumber, const struct Account *after) {
+    struct IndexedAccount **link = indexedLink(indexes, accountNumber);
+    struct IndexedAccount *held = *link;
+
+    if (held != NULL) {
+        if (!btreeRemove(&indexes->byBalance, held->balance, held->accountNumber)
+            || !btreeRemove(&indexes->byLastLogin, held->lastLogin, held->accountNumber)) {
+            return 0;
+        }
+        if (after == NULL) {
+            *link = held->next;
+            free(held);
+            indexes->accountCount--;
+            return 1;
+        }
+    } else if (after == NULL) {
+        return 1;
+    } else {
+        if ((held = calloc(1, sizeof(struct IndexedAccount))) == NULL) {
+            return 0;
+        }
+        memcpy(held->accountNumber, accountNumber, strnlen(accountNumber, sizeof(held->accountNumber) - 1));
+        *link = held;
+        indexes->accountCount++;
+    }
+
+    held->balance = after->checkingBalance;
+    held->lastLogin = after->lastLoginTime;
+    if (!btreeInsert(&indexes->byBalance, held->balance, held->accountNumber)
+        || !btreeInsert(&indexes->byLastLogin, held->lastLogin, held->accountNumber)) {
+        return 0;
+    }
+    if (indexes->accountCount > indexes->bucketCount) {
+        growIndexedAccounts(indexes);
+    }
+    return 1;
+}
+
+// Builds both indexes with one pass over an open account file, read in
+// blocks because the engine's stream is unbuffered. Returns 0 if out of
+// memory, leaving the indexes unloaded.
+int buildAccountIndexes(struct AccountIndexes *indexes, FILE *file) {
+    struct Account block[SCAN_BLOCK_RECORDS];
+    size_t read;
+
+    if (indexes->loaded) {
+        return 1;
+    }
+
+    indexes->bucketCount = INITIAL_BUCKETS;
+    indexes->accounts = calloc(indexes->bucketCount, sizeof(struct IndexedAccount *));
+    if (indexes->accounts == NULL) {
+        indexes->bucketCount = 0;
+        return 0;
+    }
+    if (fseek(file, recordOffset(0), SEEK_SET) == 0) {
+        while ((read = fread(block, sizeof(struct Account), SCAN_BLOCK_RECORDS, file)) > 0) {
+            for (size_t i = 0; i < read; i++) {
+                if (!indexAccount(indexes, block[i].accountNumber, &block[i])) {
+                    freeAccountIndexes(indexes);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    indexes->loaded = 1;
+    return 1;
+}
+
+// Applies one change to an account's record; after is NULL if the account
+// was deleted. Does nothing until the indexes have been built. If they
+// cannot be updated (out of memory) they are dropped, to be rebuilt on next
+// use, and 0 is returned.
+int updateAccountIndexes(struct AccountIndexes *indexes, const char *accountNumber, const struct Account *after) {
+    if (!indexes->loaded) {
+        return 1;
+    }
+    if (!indexAccount(indexes, accountNumber, after)) {
+        freeAccountIndexes(indexes);
+        return 0;
+    }
+    return 1;
+}
+
+void freeAccountIndexes(struct AccountIndexes *indexes) {
+    btreeFree(&indexes->byBalance);
+    btreeFree(&indexes->byLastLogin);
+    for (int i = 0; i < indexes->bucketCount; i++) {
+        struct IndexedAccount *entry = indexes->accounts[i];
+        while (entry != NULL) {
+            struct IndexedAccount *next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(indexes->accounts);
+    indexes->accounts = NULL;
+    indexes->bucketCount = 0;
+    indexes->accountCount = 0;
+    indexes->loaded = 0;
+}
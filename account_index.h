@@ -0,0 +1,67 @@
+#ifndef ACCOUNT_INDEX_H
+#define ACCOUNT_INDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "account_file.h"
+
+// In-memory B+tree secondary indexes over the account file. Entries are
+// ordered by (key, accountNumber) so equal keys stay distinct. Leaves are
+// linked both ways for ascending range scans and descending top-N scans.
+//
+// The indexes belong to the engine handle that built them: they are loaded
+// from the file on first use and then kept current by the engine operations
+// that write records (create, login, update, delete). Other handles change
+// records meanwhile, so the keys an account is indexed under are remembered
+// and a change removes those rather than the ones in the record it replaces.
+#define INDEX_ORDER 32
+
+struct IndexEntry {
+    int64_t key;
+    char accountNumber[20];
+};
+
+struct IndexNode {
+    int leaf;
+    int count;                                   // entries (leaf) or separators
+    struct IndexEntry entries[INDEX_ORDER];
+    struct IndexNode *children[INDEX_ORDER + 1]; // internal nodes only
+    struct IndexNode *prev, *next;               // leaf chain
+};
+
+struct BTree {
+    struct IndexNode *root;
+    int size;
+};
+
+// Return 0 from a visitor to stop the scan.
+typedef int (*IndexVisitor)(const struct IndexEntry *entry, void *context);
+
+int btreeInsert(struct BTree *tree, int64_t key, const char *accountNumber);
+int btreeRemove(struct BTree *tree, int64_t key, const char *accountNumber);
+void btreeScanFrom(const struct BTree *tree, int64_t from, IndexVisitor visit, void *context);
+void btreeScanDescending(const struct BTree *tree, IndexVisitor visit, void *context);
+void btreeFree(struct BTree *tree);
+
+// Keys an account currently has in the trees.
+struct IndexedAccount {
+    char accountNumber[20];
+    int64_t balance;
+    int64_t lastLogin;
+    struct IndexedAccount *next;
+};
+
+struct AccountIndexes {
+    int loaded;
+    struct BTree byBalance;     // checkingBalance, cents
+    struct BTree byLastLogin;   // lastLoginTime
+    struct IndexedAccount **accounts; // hash chains by account number
+    int bucketCount;            // power of two
+    int accountCount;
+};
+
+int buildAccountIndexes(struct AccountIndexes *indexes, FILE *file);
+int updateAccountIndexes(struct AccountIndexes *indexes, const char *accountNumber, const struct Account *after);
+void freeAccountIndexes(struct AccountIndexes *indexes);
+
+#endif
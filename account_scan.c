@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "account_scan.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCAN_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled per function and chosen at run time, which needs the GCC
+// and Clang target attribute; other compilers stop at SSE2.
+#if SCAN_HAVE_SSE2 && defined(__GNUC__)
+#define SCAN_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define KEY_SIZE 20
+
+typedef long (*BlockScanner)(const unsigned char *block, long count, const unsigned char *key);
+
+static long scanBlockScalar(const unsigned char *block, long count, const unsigned char *key) {
+    for (long i = 0; i < count; i++) {
+        if (memcmp(block + i * ACCOUNT_RECORD_SIZE, key, KEY_SIZE) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#if SCAN_HAVE_SSE2
+// First 16 key bytes with one vector compare, the last 4 as a 32-bit word.
+static long scanBlockSse2(const unsigned char *block, long count, const unsigned char *key) {
+    __m128i head = _mm_loadu_si128((const __m128i *)key);
+    uint32_t tail;
+    memcpy(&tail, key + 16, sizeof(tail));
+
+    for (long i = 0; i < count; i++) {
+        const unsigned char *record = block + i * ACCOUNT_RECORD_SIZE;
+        __m128i field = _mm_loadu_si128((const __m128i *)record);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(field, head)) == 0xFFFF) {
+            uint32_t recordTail;
+            memcpy(&recordTail, record + 16, sizeof(recordTail));
+            if (recordTail == tail) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+#endif
+
+#if SCAN_HAVE_AVX2
+// One 32-byte compare covers the whole key; the 12 bytes past it are masked
+// off. Two records per iteration keep both load ports busy.
+__attribute__((target("avx2")))
+static long scanBlockAvx2(const unsigned char *block, long count, const unsigned char *key) {
+    unsigned char padded[32] = {0};
+    memcpy(padded, key, KEY_SIZE);
+    __m256i needle = _mm256_loadu_si256((const __m256i *)padded);
+    const uint32_t keyMask = (1u << KEY_SIZE) - 1;
+    long i = 0;
+
+    for (; i + 1 < count; i += 2) {
+        const unsigned char *record = block + i * ACCOUNT_RECORD_SIZE;
+        __m256i first = _mm256_loadu_si256((const __m256i *)record);
+        __m256i second = _mm256_loadu_si256((const __m256i *)(record + ACCOUNT_RECORD_SIZE));
+        uint32_t firstMask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(first, needle));
+        uint32_t secondMask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(second, needle));
+        if ((firstMask & keyMask) == keyMask) {
+            return i;
+        }
+        if ((secondMask & keyMask) == keyMask) {
+            return i + 1;
+        }
+    }
+    if (i < count) {
+        __m256i field = _mm256_loadu_si256((const __m256i *)(block + i * ACCOUNT_RECORD_SIZE));
+        if (((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(field, needle)) & keyMask) == keyMask) {
+            return i;
+        }
+    }
+    return -1;
+}
+#endif
+
+// Returns the scanner for kind, or NULL if this build or CPU lacks it.
+// SCAN_AUTO takes the widest one available. Nothing is cached, so callers on
+// any thread can ask; the CPU feature check is a read of data the runtime
+// filled in before main.
+static BlockScanner scannerFor(enum ScanKind kind) {
+#if SCAN_HAVE_AVX2
+    if ((kind == SCAN_AVX2 || kind == SCAN_AUTO) && __builtin_cpu_supports("avx2")) {
+        return scanBlockAvx2;
+    }
+#endif
+#if SCAN_HAVE_SSE2
+    if (kind == SCAN_SSE2 || kind == SCAN_AUTO) {
+        return scanBlockSse2;
+    }
+#endif
+    if (kind == SCAN_SCALAR || kind == SCAN_AUTO) {
+        return scanBlockScalar;
+    }
+    return NULL;
+}
+
+int scanKindAvailable(enum ScanKind kind) {
+    return scannerFor(kind) != NULL;
+}
+
+// The kind SCAN_AUTO stands for on this CPU.
+enum ScanKind bestScanKind(void) {
+    const enum ScanKind kinds[] = { SCAN_AVX2, SCAN_SSE2 };
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        if (scanKindAvailable(kinds[k])) {
+            return kinds[k];
+        }
+    }
+    return SCAN_SCALAR;
+}
+
+const char *scanKindName(enum ScanKind kind) {
+    switch (kind == SCAN_AUTO ? bestScanKind() : kind) {
+        case SCAN_AVX2: return "avx2";
+        case SCAN_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+// Scans the records of an open account file for accountNumber with the given
+// scanner (SCAN_AUTO or one that scanKindAvailable accepts). Returns the
+// record index and copies the record to found (if not NULL), or -1. The
+// stream position afterwards is unspecified; use recordOffset() to write.
+long findAccountRecord(FILE *file, const char *accountNumber, struct Account *found, enum ScanKind kind) {
+    BlockScanner scanner = scannerFor(kind);
+    struct Account block[SCAN_BLOCK_RECORDS];
+    unsigned char key[KEY_SIZE] = {0};
+    long base = 0;
+    size_t read;
+
+    if (scanner == NULL || strlen(accountNumber) >= KEY_SIZE) {
+        return -1;
+    }
+    memcpy(key, accountNumber, strlen(accountNumber));
+
+    if (fseek(file, recordOffset(0), SEEK_SET) != 0) {
+        return -1;
+    }
+
+    while ((read = fread(block, sizeof(struct Account), SCAN_BLOCK_RECORDS, file)) > 0) {
+        long hit = scanner((const unsigned char *)block, (long)read, key);
+        if (hit >= 0) {
+            if (found != NULL) {
+                *found = block[hit];
+            }
+            return base + hit;
+        }
+        base += (long)read;
+    }
+
+    return -1;
+}
@@ -0,0 +1,25 @@
+#ifndef ACCOUNT_SCAN_H
+#define ACCOUNT_SCAN_H
+
+#include <stdio.h>
+#include "account_file.h"
+
+// Unindexed lookup by account number. The file is read in blocks of
+// SCAN_BLOCK_RECORDS records and the 20-byte accountNumber field at the
+// start of each 64-byte record is compared against a NUL-padded key with
+// AVX2 or SSE2 when the CPU has them, falling back to plain C.
+#define SCAN_BLOCK_RECORDS 512
+
+enum ScanKind {
+    SCAN_AUTO,
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2
+};
+
+long findAccountRecord(FILE *file, const char *accountNumber, struct Account *found, enum ScanKind kind);
+int scanKindAvailable(enum ScanKind kind);
+enum ScanKind bestScanKind(void);
+const char *scanKindName(enum ScanKind kind);
+
+#endif
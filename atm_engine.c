@@ -0,0 +1,1076 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+#include "atm_engine.h"
+#include "interest.h"
+#include "velocity.h"
+#include "account_scan.h"
+
+#define DEFAULT_JOURNAL "transactions.log"
+#define DEFAULT_SECURITY_LOG "security.log"
+#define LOCKOUT_ATTEMPTS 3
+#define LOCKOUT_SECONDS 1800
+#define ORDER_BATCH 256                 // standing orders run per account file lock
+
+// Last known record index of an account. Hints are checked against the
+// record before use, so one left stale by another process only costs a scan.
+struct SlotHint {
+    char accountNumber[20];      // empty = unused slot
+    long index;
+};
+
+struct AtmEngine {
+    FILE *accounts;
+    FILE *journal;
+    FILE *journalReader;         // separate read stream for catchUpVelocity
+    long journalOffset;          // journal bytes reflected in velocity
+    FILE *securityLog;
+    struct FileHeader header;    // reread under the lock before every update
+    struct SlotHint *hints;
+    long hintCapacity;           // power of two, or 0
+    long hintCount;
+    enum ScanKind scanKind;      // chosen once at open
+    struct AccountIndexes indexes;
+    struct VelocityTracker velocity;
+    struct Scheduler schedules;
+    struct AtmStats stats;
+};
+
+// A stored record changed by a batch of standing orders.
+struct BatchAccount {
+    long index;
+    struct Account before;       // as read under the lock
+    struct Account acc;
+};
+
+// A batch runs under one hold of the account file lock. Each account it
+// touches is read once and written back once before the lock is released,
+// however many orders in the batch use it.
+struct OrderBatch {
+    struct StandingOrder orders[ORDER_BATCH];
+    int orderCount;
+    struct BatchAccount accounts[2 * ORDER_BATCH];
+    int accountCount;
+};
+
+struct ReportFilter {
+    IndexVisitor visit;
+    void *context;
+    long limit;                  // -1 for no limit
+    int64_t below;
+    long shown;
+};
+
+static double engineClock(void) {
+#ifdef _WIN32
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)now.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void localTime(time_t when, struct tm *out) {
+#ifdef _WIN32
+    localtime_s(out, &when);
+#else
+    localtime_r(&when, out);
+#endif
+}
+
+static void lockStream(FILE *file) {
+#ifdef _WIN32
+    // Windows locks are mandatory, so lock a byte far past the data rather
+    // than the header, which other handles still need to read.
+    OVERLAPPED region;
+    memset(&region, 0, sizeof(region));
+    region.Offset = 0xFFFFFFFE;
+    region.OffsetHigh = 0x7FFFFFFF;
+    LockFileEx((HANDLE)_get_osfhandle(_fileno(file)), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &region);
+#else
+    flock(fileno(file), LOCK_EX);
+#endif
+}
+
+static void unlockStream(FILE *file) {
+    fflush(file);
+#ifdef _WIN32
+    OVERLAPPED region;
+    memset(&region, 0, sizeof(region));
+    region.Offset = 0xFFFFFFFE;
+    region.OffsetHigh = 0x7FFFFFFF;
+    UnlockFileEx((HANDLE)_get_osfhandle(_fileno(file)), 0, 1, 0, &region);
+#else
+    flock(fileno(file), LOCK_UN);
+#endif
+}
+
+static int truncateStream(FILE *file, long size) {
+    fflush(file);
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), size) == 0;
+#endif
+}
+
+static struct SlotHint *hintSlot(struct SlotHint *hints, long capacity, const char *accountNumber) {
+    long i = hashAccount(accountNumber) & (capacity - 1);
+    while (hints[i].accountNumber[0] != '\0' && strcmp(hints[i].accountNumber, accountNumber) != 0) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &hints[i];
+}
+
+static long hintLookup(struct AtmEngine *engine, const char *accountNumber) {
+    if (engine->hintCapacity == 0) {
+        return -1;
+    }
+    struct SlotHint *slot = hintSlot(engine->hints, engine->hintCapacity, accountNumber);
+    return slot->accountNumber[0] != '\0' ? slot->index : -1;
+}
+
+static void hintStore(struct AtmEngine *engine, const char *accountNumber, long index) {
+    if ((engine->hintCount + 1) * 2 > engine->hintCapacity) {
+        long capacity = engine->hintCapacity ? engine->hintCapacity * 2 : 256;
+        struct SlotHint *hints = calloc(capacity, sizeof(struct SlotHint));
+        if (hints == NULL) {
+            return; // hints are only an optimisation
+        }
+        for (long i = 0; i < engine->hintCapacity; i++) {
+            if (engine->hints[i].accountNumber[0] != '\0') {
+                *hintSlot(hints, capacity, engine->hints[i].accountNumber) = engine->hints[i];
+            }
+        }
+        free(engine->hints);
+        engine->hints = hints;
+        engine->hintCapacity = capacity;
+    }
+
+    struct SlotHint *slot = hintSlot(engine->hints, engine->hintCapacity, accountNumber);
+    if (slot->accountNumber[0] == '\0') {
+        strcpy(slot->accountNumber, accountNumber);
+        engine->hintCount++;
+    }
+    slot->index = index;
+}
+
+static int readRecord(struct AtmEngine *engine, long index, struct Account *acc) {
+    double start = engineClock();
+    int ok = fseek(engine->accounts, recordOffset(index), SEEK_SET) == 0
+          && fread(acc, sizeof(struct Account), 1, engine->accounts) == 1;
+    engine->stats.ioSeconds += engineClock() - start;
+    return ok;
+}
+
+static int writeRecord(struct AtmEngine *engine, long index, const struct Account *acc) {
+    double start = engineClock();
+    int ok = fseek(engine->accounts, recordOffset(index), SEEK_SET) == 0
+          && fwrite(acc, sizeof(struct Account), 1, engine->accounts) == 1;
+    engine->stats.ioSeconds += engineClock() - start;
+    return ok;
+}
+
+static int storeHeader(struct AtmEngine *engine) {
+    double start = engineClock();
+    int ok = writeHeader(engine->accounts, &engine->header);
+    engine->stats.ioSeconds += engineClock() - start;
+    return ok;
+}
+
+// Takes the account file lock and refreshes the cached header, which other
+// processes may have changed since the last call.
+static enum AtmStatus beginUpdate(struct AtmEngine *engine) {
+    double start = engineClock();
+    lockStream(engine->accounts);
+    engine->stats.lockWaitSeconds += engineClock() - start;
+
+    start = engineClock();
+    int ok = readHeader(engine->accounts, &engine->header);
+    engine->stats.ioSeconds += engineClock() - start;
+    if (!ok) {
+        unlockStream(engine->accounts);
+        return ATM_ERROR_LAYOUT;
+    }
+
+    engine->stats.operations++;
+    return ATM_OK;
+}
+
+static void endUpdate(struct AtmEngine *engine) {
+    unlockStream(engine->accounts);
+}
+
+static int validAccountNumber(const char *accountNumber) {
+    size_t length = strlen(accountNumber);
+    return length > 0 && length < sizeof(((struct Account *)0)->accountNumber);
+}
+
+// Finds an account's record, trying the slot hint before a full scan.
+static long findIndex(struct AtmEngine *engine, const char *accountNumber, struct Account *acc) {
+    long hint = hintLookup(engine, accountNumber);
+    if (hint >= 0 && hint < (long)engine->header.recordCount && readRecord(engine, hint, acc)
+        && strcmp(acc->accountNumber, accountNumber) == 0) {
+        return hint;
+    }
+
+    double start = engineClock();
+    long index = findAccountRecord(engine->accounts, accountNumber, acc, engine->scanKind);
+    engine->stats.ioSeconds += engineClock() - start;
+
+    if (index >= 0) {
+        hintStore(engine, accountNumber, index);
+    }
+    return index;
+}
+
+// Locks the file and reads the stored record of an account. On ATM_OK the
+// lock is still held and the caller finishes with storeAccount.
+static enum AtmStatus lockAccount(struct AtmEngine *engine, const char *accountNumber,
+                                  struct Account *stored, long *index) {
+    if (!validAccountNumber(accountNumber)) {
+        return ATM_ERROR_INVALID_ACCOUNT;
+    }
+    enum AtmStatus status = beginUpdate(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    *index = findIndex(engine, accountNumber, stored);
+    if (*index < 0) {
+        endUpdate(engine);
+        return ATM_ERROR_NOT_FOUND;
+    }
+    return ATM_OK;
+}
+
+// Writes a record changed under the lock over its previous contents and
+// keeps the header checksum and report indexes in step. The lock stays held.
+// The indexes drop themselves if they run out of memory; the report that
+// next needs them rebuilds them or returns ATM_ERROR_NO_MEMORY.
+static int writeChange(struct AtmEngine *engine, long index, const struct Account *before, const struct Account *after) {
+    int ok = writeRecord(engine, index, after);
+    engine->header.checksum += recordChecksum(after) - recordChecksum(before);
+    updateAccountIndexes(&engine->indexes, after->accountNumber, after);
+    return ok;
+}
+
+// Finishes a lockAccount: writes the record back, commits the header and
+// releases the lock.
+static enum AtmStatus storeAccount(struct AtmEngine *engine, long index, const struct Account *before,
+                                   const struct Account *after) {
+    int ok = writeChange(engine, index, before, after);
+    ok = storeHeader(engine) && ok;
+    endUpdate(engine);
+    return ok ? ATM_OK : ATM_ERROR_IO;
+}
+
+static void journalEntry(struct AtmEngine *engine, const char *accountNumber, const char *type,
+                         int64_t amount, time_t when) {
+    char date[32];
+    struct tm tm;
+
+    localTime(when, &tm);
+    strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Y", &tm);
+
+    double start = engineClock();
+    fprintf(engine->journal, "%s %s %.2f %lld %s\n", accountNumber, type, amount / 100.0, (long long)when, date);
+    fflush(engine->journal);
+    engine->stats.ioSeconds += engineClock() - start;
+}
+
+// Credits interest owed since the last accrual and journals it. Settle
+// before changing the balance so the old balance stops earning.
+static int64_t creditInterest(struct AtmEngine *engine, struct Account *acc, int settle) {
+    time_t now = time(NULL);
+    int64_t interest = settle ? settleInterest(acc, now) : accrueInterest(acc, now);
+
+    if (interest > 0) {
+        journalEntry(engine, acc->accountNumber, "Interest", interest, now);
+    }
+    return interest;
+}
+
+static int isLockedOut(struct Account *acc, time_t now) {
+    if (acc->failedLoginAttempts >= LOCKOUT_ATTEMPTS) {
+        if (difftime(now, acc->lastLoginTime) > LOCKOUT_SECONDS) {
+            acc->failedLoginAttempts = 0;
+            return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+enum AtmStatus atmOpen(struct AtmEngine **result, const struct AtmConfig *config) {
+    const char *accountPath = config != NULL && config->accountPath != NULL ? config->accountPath : FILE_NAME;
+    const char *journalPath = config != NULL && config->journalPath != NULL ? config->journalPath : DEFAULT_JOURNAL;
+    const char *securityPath = config != NULL && config->securityLogPath != NULL ? config->securityLogPath : DEFAULT_SECURITY_LOG;
+    const char *schedulePath = config != NULL && config->schedulePath != NULL ? config->schedulePath : SCHEDULE_FILE_NAME;
+    enum AtmStatus status = ATM_OK;
+
+    *result = NULL;
+    struct AtmEngine *engine = calloc(1, sizeof(struct AtmEngine));
+    if (engine == NULL) {
+        return ATM_ERROR_NO_MEMORY;
+    }
+
+    engine->scanKind = bestScanKind();
+    engine->accounts = fopen(accountPath, "r+b");
+    int created = engine->accounts == NULL && errno == ENOENT;
+    if (created) {
+        engine->accounts = fopen(accountPath, "w+b");
+    }
+    if (engine->accounts == NULL) {
+        status = ATM_ERROR_IO;
+    } else {
+        // Other handles write the file between our operations, so a stdio
+        // read buffer would go stale. Record and block reads are large
+        // enough to go straight to the OS. setvbuf must come before the
+        // first read or write on the stream.
+        setvbuf(engine->accounts, NULL, _IONBF, 0);
+        if (created ? !initAccountFile(engine->accounts, &engine->header)
+                    : !readHeader(engine->accounts, &engine->header)) {
+            status = created ? ATM_ERROR_IO : ATM_ERROR_LAYOUT;
+        }
+    }
+
+    if (status == ATM_OK) {
+        engine->journal = fopen(journalPath, "a");
+        engine->journalReader = fopen(journalPath, "rb");
+        engine->securityLog = fopen(securityPath, "a");
+        if (engine->journal == NULL || engine->journalReader == NULL || engine->securityLog == NULL
+            || !openScheduler(&engine->schedules, schedulePath, time(NULL))) {
+            status = ATM_ERROR_IO;
+        }
+    }
+
+    if (status != ATM_OK) {
+        atmClose(engine);
+        return status;
+    }
+
+    if (!initVelocityTracker(&engine->velocity)
+        || !loadVelocityHistory(&engine->velocity, engine->journalReader, &engine->journalOffset, time(NULL))) {
+        atmClose(engine);
+        return ATM_ERROR_NO_MEMORY;
+    }
+
+    *result = engine;
+    return ATM_OK;
+}
+
+void atmClose(struct AtmEngine *engine) {
+    if (engine == NULL) {
+        return;
+    }
+    if (engine->accounts != NULL) {
+        fclose(engine->accounts);
+    }
+    if (engine->journal != NULL) {
+        fclose(engine->journal);
+    }
+    if (engine->journalReader != NULL) {
+        fclose(engine->journalReader);
+    }
+    if (engine->securityLog != NULL) {
+        fclose(engine->securityLog);
+    }
+    if (engine->schedules.file != NULL) {
+        closeScheduler(&engine->schedules);
+    }
+    if (engine->velocity.buckets != NULL) {
+        freeVelocityTracker(&engine->velocity);
+    }
+    freeAccountIndexes(&engine->indexes);
+    free(engine->hints);
+    free(engine);
+}
+
+const char *atmStatusMessage(enum AtmStatus status) {
+    switch (status) {
+        case ATM_OK: return "OK";
+        case ATM_ERROR_IO: return "Error accessing account records";
+        case ATM_ERROR_LAYOUT: return "Account file has an unsupported layout; convert it with migrate_accounts";
+        case ATM_ERROR_NO_MEMORY: return "Out of memory";
+        case ATM_ERROR_INVALID_ACCOUNT: return "Invalid account number";
+        case ATM_ERROR_NOT_FOUND: return "Account not found";
+        case ATM_ERROR_EXISTS: return "Account number already exists";
+        case ATM_ERROR_BAD_PIN: return "Incorrect PIN";
+        case ATM_ERROR_LOCKED: return "Account locked due to multiple failed login attempts";
+        case ATM_ERROR_INVALID_PIN: return "PIN must be exactly 4 digits";
+        case ATM_ERROR_INVALID_AMOUNT: return "Invalid amount";
+        case ATM_ERROR_INSUFFICIENT_FUNDS: return "Insufficient balance";
+        case ATM_ERROR_DAILY_LIMIT: return "Daily withdrawal limit reached";
+        case ATM_ERROR_INVALID_ORDER: return "Invalid standing order";
+        case ATM_ERROR_ORDER_NOT_FOUND: return "Standing order not found";
+    }
+    return "Unknown error";
+}
+
+int atmValidPin(const char *pin) {
+    return strlen(pin) == 4 && strspn(pin, "0123456789") == 4;
+}
+
+enum AtmStatus atmAccountExists(struct AtmEngine *engine, const char *accountNumber) {
+    struct Account acc;
+    return atmLoadAccount(engine, accountNumber, &acc);
+}
+
+// Reads an account without a PIN check or login bookkeeping, for back-office
+// callers such as the standing order runner.
+enum AtmStatus atmLoadAccount(struct AtmEngine *engine, const char *accountNumber, struct Account *acc) {
+    if (!validAccountNumber(accountNumber)) {
+        return ATM_ERROR_INVALID_ACCOUNT;
+    }
+    enum AtmStatus status = beginUpdate(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    long index = findIndex(engine, accountNumber, acc);
+    endUpdate(engine);
+    return index >= 0 ? ATM_OK : ATM_ERROR_NOT_FOUND;
+}
+
+enum AtmStatus atmCreateAccount(struct AtmEngine *engine, const char *accountNumber, const char *pin) {
+    struct Account acc;
+
+    if (!validAccountNumber(accountNumber)) {
+        return ATM_ERROR_INVALID_ACCOUNT;
+    }
+    if (!atmValidPin(pin)) {
+        return ATM_ERROR_INVALID_PIN;
+    }
+    enum AtmStatus status = beginUpdate(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    if (findIndex(engine, accountNumber, &acc) >= 0) {
+        endUpdate(engine);
+        return ATM_ERROR_EXISTS;
+    }
+
+    memset(&acc, 0, sizeof(struct Account));
+    strcpy(acc.accountNumber, accountNumber);
+    strcpy(acc.pin, pin);
+    acc.lastAccrualTime = (uint32_t)time(NULL);
+
+    long index = engine->header.recordCount;
+    if (!writeRecord(engine, index, &acc)) {
+        endUpdate(engine);
+        return ATM_ERROR_IO;
+    }
+    engine->header.recordCount++;
+    engine->header.checksum += recordChecksum(&acc);
+    int ok = storeHeader(engine);
+    endUpdate(engine);
+
+    hintStore(engine, accountNumber, index);
+    updateAccountIndexes(&engine->indexes, acc.accountNumber, &acc);
+    return ok ? ATM_OK : ATM_ERROR_IO;
+}
+
+// Checks the PIN and records the attempt. On success acc holds the account
+// with interest brought up to date.
+enum AtmStatus atmLogin(struct AtmEngine *engine, const char *accountNumber, const char *pin, struct Account *acc) {
+    long index;
+
+    enum AtmStatus status = lockAccount(engine, accountNumber, acc, &index);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    struct Account before = *acc;
+    time_t now = time(NULL);
+    if (strcmp(acc->pin, pin) == 0) {
+        acc->failedLoginAttempts = 0;
+        acc->lastLoginTime = now;
+        creditInterest(engine, acc, 0);
+    } else {
+        acc->failedLoginAttempts++;
+        struct Account check = *acc;
+        status = isLockedOut(&check, now) ? ATM_ERROR_LOCKED : ATM_ERROR_BAD_PIN;
+    }
+
+    enum AtmStatus stored = storeAccount(engine, index, &before, acc);
+    return stored != ATM_OK ? stored : status;
+}
+
+// Applies a deposit to a record read under the lock.
+static enum AtmStatus credit(struct AtmEngine *engine, struct Account *acc, int64_t amount) {
+    if (amount <= 0) {
+        return ATM_ERROR_INVALID_AMOUNT;
+    }
+
+    creditInterest(engine, acc, 1);
+    acc->checkingBalance += amount;
+    journalEntry(engine, acc->accountNumber, "Deposit", amount, time(NULL));
+    engine->stats.operations++;
+    return ATM_OK;
+}
+
+// Applies a debit to a record read under the lock, so the funds check sees
+// the stored balance. Shared by cash withdrawals and standing orders.
+// Standing order debits were authorised when the order was set up, so they
+// are journalled as Payment and do not count towards the daily limits or
+// velocity alerts.
+//
+// Cash withdrawals are checked and journalled under the journal lock, taken
+// after the account file lock. Catching up with the journal first adds the
+// withdrawals made at other terminals, so the daily limits are shared.
+static enum AtmStatus debit(struct AtmEngine *engine, struct Account *acc, int64_t amount, int cash) {
+    char event[128];
+    enum WithdrawalVerdict verdict = WITHDRAWAL_OK;
+
+    creditInterest(engine, acc, 1);
+    if (amount <= 0) {
+        return ATM_ERROR_INVALID_AMOUNT;
+    }
+    if (amount > acc->checkingBalance) {
+        return ATM_ERROR_INSUFFICIENT_FUNDS;
+    }
+
+    time_t now = time(NULL);
+    if (cash) {
+        lockStream(engine->journal);
+        verdict = catchUpVelocity(&engine->velocity, engine->journalReader, &engine->journalOffset, now)
+            ? checkWithdrawal(&engine->velocity, acc->accountNumber, amount, now) : WITHDRAWAL_NO_MEMORY;
+        if (verdict != WITHDRAWAL_OK) {
+            unlockStream(engine->journal);
+        }
+    }
+    if (verdict == WITHDRAWAL_NO_MEMORY) {
+        return ATM_ERROR_NO_MEMORY;
+    }
+    if (verdict != WITHDRAWAL_OK) {
+        snprintf(event, sizeof(event), "Withdrawal of $%.2f refused on account %s: daily %s limit",
+                 amount / 100.0, acc->accountNumber, verdict == WITHDRAWAL_OVER_DAILY_COUNT ? "count" : "amount");
+        atmLogSecurityEvent(engine, event);
+        return ATM_ERROR_DAILY_LIMIT;
+    }
+
+    acc->checkingBalance -= amount;
+    journalEntry(engine, acc->accountNumber, cash ? "Withdrawal" : "Payment", amount, now);
+    engine->stats.operations++;
+
+    int burst = 0;
+    if (cash) {
+        // Lines appended since the catch-up hold no withdrawals, as those
+        // need the lock, so the offset can skip to the end of our own.
+        burst = recordWithdrawal(&engine->velocity, acc->accountNumber, amount, now);
+        engine->journalOffset = ftell(engine->journal);
+        unlockStream(engine->journal);
+    }
+    if (burst > 0) {
+        snprintf(event, sizeof(event), "Abnormal withdrawal velocity on account %s: %d withdrawals in %d minutes",
+                 acc->accountNumber, burst, VELOCITY_WINDOW / 60);
+        atmLogSecurityEvent(engine, event);
+    }
+    return ATM_OK;
+}
+
+// Balance changes are made to the stored record under the lock and the
+// caller's copy is refreshed from it afterwards, so concurrent sessions on
+// one account never overwrite each other. Interest credited on the way is
+// written back even when the change itself is refused.
+enum AtmStatus atmDeposit(struct AtmEngine *engine, struct Account *acc, int64_t amount) {
+    struct Account stored;
+    long index;
+
+    if (amount <= 0) {
+        return ATM_ERROR_INVALID_AMOUNT;
+    }
+    enum AtmStatus status = lockAccount(engine, acc->accountNumber, &stored, &index);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    struct Account before = stored;
+    status = credit(engine, &stored, amount);
+    enum AtmStatus written = storeAccount(engine, index, &before, &stored);
+    *acc = stored;
+    return written != ATM_OK ? written : status;
+}
+
+enum AtmStatus atmWithdraw(struct AtmEngine *engine, struct Account *acc, int64_t amount) {
+    struct Account stored;
+    long index;
+
+    enum AtmStatus status = lockAccount(engine, acc->accountNumber, &stored, &index);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    struct Account before = stored;
+    status = debit(engine, &stored, amount, 1);
+    enum AtmStatus written = storeAccount(engine, index, &before, &stored);
+    *acc = stored;
+    return written != ATM_OK ? written : status;
+}
+
+enum AtmStatus atmCheckBalance(struct AtmEngine *engine, struct Account *acc) {
+    int64_t credited;
+    return atmApplyInterest(engine, acc, &credited);
+}
+
+enum AtmStatus atmApplyInterest(struct AtmEngine *engine, struct Account *acc, int64_t *credited) {
+    struct Account stored;
+    long index;
+
+    *credited = 0;
+    enum AtmStatus status = lockAccount(engine, acc->accountNumber, &stored, &index);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    struct Account before = stored;
+    *credited = creditInterest(engine, &stored, 0);
+    status = storeAccount(engine, index, &before, &stored);
+    *acc = stored;
+    return status;
+}
+
+// Checks currentPin against the stored record, not the caller's copy, so a
+// PIN changed at another terminal is the one that must be given.
+enum AtmStatus atmChangePin(struct AtmEngine *engine, struct Account *acc, const char *currentPin, const char *newPin) {
+    struct Account stored;
+    long index;
+
+    if (!atmValidPin(newPin)) {
+        return ATM_ERROR_INVALID_PIN;
+    }
+    enum AtmStatus status = lockAccount(engine, acc->accountNumber, &stored, &index);
+    if (status != ATM_OK) {
+        return status;
+    }
+    if (strcmp(stored.pin, currentPin) != 0) {
+        endUpdate(engine);
+        *acc = stored;
+        return ATM_ERROR_BAD_PIN;
+    }
+
+    struct Account before = stored;
+    memset(stored.pin, 0, sizeof(stored.pin));
+    strcpy(stored.pin, newPin);
+    status = storeAccount(engine, index, &before, &stored);
+    *acc = stored;
+    return status;
+}
+
+// Accrues interest and refreshes the caller's copy from the stored record,
+// e.g. at logout. Nothing is taken from the copy: the PIN, login fields and
+// balances are only changed by the locked operations above.
+enum AtmStatus atmRefreshAccount(struct AtmEngine *engine, struct Account *acc) {
+    struct Account stored;
+    long index;
+
+    enum AtmStatus status = lockAccount(engine, acc->accountNumber, &stored, &index);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    struct Account before = stored;
+    creditInterest(engine, &stored, 0);
+
+    status = storeAccount(engine, index, &before, &stored);
+    *acc = stored;
+    return status;
+}
+
+// Takes the schedule file lock and catches up with orders written by other
+// processes, compacting the log if it has grown mostly stale.
+static enum AtmStatus beginSchedules(struct AtmEngine *engine) {
+    double start = engineClock();
+    lockStream(engine->schedules.file);
+    engine->stats.lockWaitSeconds += engineClock() - start;
+
+    if (!syncScheduler(&engine->schedules) || !compactScheduler(&engine->schedules)) {
+        unlockStream(engine->schedules.file);
+        return ATM_ERROR_IO;
+    }
+    return ATM_OK;
+}
+
+static void endSchedules(struct AtmEngine *engine) {
+    unlockStream(engine->schedules.file);
+}
+
+// Cancels every active order paid from or into a deleted account, so an
+// account later created with the same number does not inherit them. The
+// schedule file lock is held.
+static int cancelAccountOrders(struct AtmEngine *engine, const char *accountNumber) {
+    struct Scheduler *schedules = &engine->schedules;
+    int cancelled = 0;
+
+    for (uint32_t i = 0; i < schedules->orderCount; i++) {
+        struct StandingOrder order = schedules->orders[i];
+        if (order.state != ORDER_ACTIVE
+            || (strcmp(order.accountNumber, accountNumber) != 0 && strcmp(order.targetAccount, accountNumber) != 0)) {
+            continue;
+        }
+        order.state = ORDER_CANCELLED;
+        if (!appendOrder(schedules, &order)) {
+            return 0;
+        }
+        cancelled++;
+    }
+    return cancelled == 0 || commitOrders(schedules);
+}
+
+// Removes the record in place by moving the last record into its slot and
+// truncating, so other handles keep working on the same file. The account's
+// standing orders are cancelled with it; the schedule file lock is taken
+// first, as atmRunDueOrders does.
+enum AtmStatus atmDeleteAccount(struct AtmEngine *engine, const char *accountNumber) {
+    struct Account victim, moved;
+
+    if (!validAccountNumber(accountNumber)) {
+        return ATM_ERROR_INVALID_ACCOUNT;
+    }
+    enum AtmStatus status = beginSchedules(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+    status = beginUpdate(engine);
+    if (status != ATM_OK) {
+        endSchedules(engine);
+        return status;
+    }
+
+    long index = findIndex(engine, accountNumber, &victim);
+    if (index < 0) {
+        endUpdate(engine);
+        endSchedules(engine);
+        return ATM_ERROR_NOT_FOUND;
+    }
+
+    int ok = 1;
+    long last = (long)engine->header.recordCount - 1;
+    if (index != last) {
+        ok = readRecord(engine, last, &moved) && writeRecord(engine, index, &moved);
+        if (ok) {
+            hintStore(engine, moved.accountNumber, index);
+        }
+    }
+    if (ok) {
+        engine->header.recordCount--;
+        engine->header.checksum -= recordChecksum(&victim);
+        ok = storeHeader(engine) && truncateStream(engine->accounts, recordOffset(engine->header.recordCount));
+    }
+    if (ok) {
+        // Journalled under the lock like every balance change, so a new
+        // account with the same number replays after the Closed marker.
+        journalEntry(engine, accountNumber, "Closed", 0, time(NULL));
+    }
+    endUpdate(engine);
+
+    if (ok) {
+        ok = cancelAccountOrders(engine, accountNumber);
+        updateAccountIndexes(&engine->indexes, victim.accountNumber, NULL);
+    }
+    endSchedules(engine);
+    return ok ? ATM_OK : ATM_ERROR_IO;
+}
+
+static int filterEntry(const struct IndexEntry *entry, void *arg) {
+    struct ReportFilter *filter = arg;
+
+    if (filter->shown == filter->limit || entry->key >= filter->below) {
+        return 0;
+    }
+    filter->shown++;
+    return filter->visit(entry, filter->context);
+}
+
+// Builds the report indexes on first use; after that they are kept current
+// by this handle's writes.
+static enum AtmStatus loadIndexes(struct AtmEngine *engine) {
+    if (engine->indexes.loaded) {
+        return ATM_OK;
+    }
+
+    enum AtmStatus status = beginUpdate(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+    int ok = buildAccountIndexes(&engine->indexes, engine->accounts);
+    endUpdate(engine);
+    return ok ? ATM_OK : ATM_ERROR_NO_MEMORY;
+}
+
+enum AtmStatus atmTopBalances(struct AtmEngine *engine, int count, IndexVisitor visit, void *context) {
+    struct ReportFilter filter = { visit, context, count, INT64_MAX, 0 };
+
+    enum AtmStatus status = loadIndexes(engine);
+    if (status == ATM_OK && count > 0) {
+        btreeScanDescending(&engine->indexes.byBalance, filterEntry, &filter);
+    }
+    return status;
+}
+
+enum AtmStatus atmBalancesBelow(struct AtmEngine *engine, int64_t below, IndexVisitor visit, void *context) {
+    struct ReportFilter filter = { visit, context, -1, below, 0 };
+
+    enum AtmStatus status = loadIndexes(engine);
+    if (status == ATM_OK) {
+        btreeScanFrom(&engine->indexes.byBalance, INT64_MIN, filterEntry, &filter);
+    }
+    return status;
+}
+
+enum AtmStatus atmDormantSince(struct AtmEngine *engine, int64_t cutoff, IndexVisitor visit, void *context) {
+    struct ReportFilter filter = { visit, context, -1, cutoff, 0 };
+
+    enum AtmStatus status = loadIndexes(engine);
+    if (status == ATM_OK) {
+        btreeScanFrom(&engine->indexes.byLastLogin, INT64_MIN, filterEntry, &filter);
+    }
+    return status;
+}
+
+// Adds a standing order. The caller fills in kind, accountNumber,
+// targetAccount (transfers), amount, interval and nextRun (0 for now); id
+// and state are set here.
+enum AtmStatus atmScheduleOrder(struct AtmEngine *engine, struct StandingOrder *order) {
+    if (order->kind < ORDER_DEPOSIT || order->kind > ORDER_TRANSFER) {
+        return ATM_ERROR_INVALID_ORDER;
+    }
+    if (order->amount <= 0) {
+        return ATM_ERROR_INVALID_AMOUNT;
+    }
+
+    enum AtmStatus status = atmAccountExists(engine, order->accountNumber);
+    if (status == ATM_OK && order->kind == ORDER_TRANSFER) {
+        if (strcmp(order->accountNumber, order->targetAccount) == 0) {
+            return ATM_ERROR_INVALID_ORDER;
+        }
+        status = atmAccountExists(engine, order->targetAccount);
+    }
+    if (status != ATM_OK) {
+        return status;
+    }
+    if (order->kind != ORDER_TRANSFER) {
+        memset(order->targetAccount, 0, sizeof(order->targetAccount));
+    }
+    if (order->nextRun == 0) {
+        order->nextRun = (uint32_t)time(NULL);
+    }
+
+    status = beginSchedules(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+    order->id = engine->schedules.orderCount + 1;
+    order->state = ORDER_ACTIVE;
+    order->reserved0 = 0;
+    int ok = appendOrder(&engine->schedules, order) && commitOrders(&engine->schedules);
+    endSchedules(engine);
+    return ok ? ATM_OK : ATM_ERROR_IO;
+}
+
+// Cancels one of accountNumber's active orders.
+enum AtmStatus atmCancelOrder(struct AtmEngine *engine, const char *accountNumber, uint32_t id) {
+    enum AtmStatus status = beginSchedules(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    const struct StandingOrder *found = findOrder(&engine->schedules, id);
+    if (found == NULL || found->state != ORDER_ACTIVE || strcmp(found->accountNumber, accountNumber) != 0) {
+        endSchedules(engine);
+        return ATM_ERROR_ORDER_NOT_FOUND;
+    }
+
+    struct StandingOrder order = *found;
+    order.state = ORDER_CANCELLED;
+    int ok = appendOrder(&engine->schedules, &order) && commitOrders(&engine->schedules);
+    endSchedules(engine);
+    return ok ? ATM_OK : ATM_ERROR_IO;
+}
+
+// Visits the active orders paid from or into accountNumber, in id order.
+enum AtmStatus atmListOrders(struct AtmEngine *engine, const char *accountNumber, OrderVisitor visit, void *context) {
+    enum AtmStatus status = beginSchedules(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    const struct Scheduler *schedules = &engine->schedules;
+    for (uint32_t i = 0; i < schedules->orderCount; i++) {
+        const struct StandingOrder *order = &schedules->orders[i];
+        if (order->state == ORDER_ACTIVE
+            && (strcmp(order->accountNumber, accountNumber) == 0
+                || (order->kind == ORDER_TRANSFER && strcmp(order->targetAccount, accountNumber) == 0))
+            && !visit(order, context)) {
+            break;
+        }
+    }
+    endSchedules(engine);
+    return ATM_OK;
+}
+
+// Finds the batch's copy of an account, reading the stored record on first
+// use. The account file lock is held.
+static enum AtmStatus batchAccount(struct AtmEngine *engine, struct OrderBatch *batch, const char *accountNumber,
+                                   struct Account **acc) {
+    for (int i = 0; i < batch->accountCount; i++) {
+        if (strcmp(batch->accounts[i].acc.accountNumber, accountNumber) == 0) {
+            *acc = &batch->accounts[i].acc;
+            return ATM_OK;
+        }
+    }
+    if (!validAccountNumber(accountNumber)) {
+        return ATM_ERROR_INVALID_ACCOUNT;
+    }
+
+    struct BatchAccount *entry = &batch->accounts[batch->accountCount];
+    entry->index = findIndex(engine, accountNumber, &entry->before);
+    if (entry->index < 0) {
+        return ATM_ERROR_NOT_FOUND;
+    }
+    entry->acc = entry->before;
+    batch->accountCount++;
+    *acc = &entry->acc;
+    return ATM_OK;
+}
+
+static enum AtmStatus runOrder(struct AtmEngine *engine, struct OrderBatch *batch, const struct StandingOrder *order) {
+    struct Account *from, *to;
+
+    enum AtmStatus status = batchAccount(engine, batch, order->accountNumber, &from);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    switch (order->kind) {
+        case ORDER_DEPOSIT:
+            return credit(engine, from, order->amount);
+        case ORDER_WITHDRAWAL:
+            return debit(engine, from, order->amount, 0);
+        case ORDER_TRANSFER:
+            status = batchAccount(engine, batch, order->targetAccount, &to);
+            if (status == ATM_OK) {
+                status = debit(engine, from, order->amount, 0);
+            }
+            return status == ATM_OK ? credit(engine, to, order->amount) : status;
+    }
+    return ATM_ERROR_INVALID_ORDER;
+}
+
+// Runs a batch under the account file lock with the same deposit and debit
+// code as the ATM operations, applied to the stored records. Each order's
+// next state is committed before the records are written back; if the
+// process dies in between, the journal already has the movements and
+// audit_journal -rebuild restores the balances, and an order is never run
+// twice.
+static enum AtmStatus runBatch(struct AtmEngine *engine, struct OrderBatch *batch, struct AtmOrderRun *run) {
+    char event[160];
+
+    enum AtmStatus status = beginUpdate(engine);
+    if (status != ATM_OK) {
+        return status;
+    }
+
+    int ok = 1;
+    for (int i = 0; i < batch->orderCount; i++) {
+        struct StandingOrder *order = &batch->orders[i];
+        enum AtmStatus result = runOrder(engine, batch, order);
+
+        if (result == ATM_OK) {
+            run->executed++;
+        } else {
+            run->failed++;
+            snprintf(event, sizeof(event), "Standing order %u on account %s failed: %s",
+                     order->id, order->accountNumber, atmStatusMessage(result));
+            atmLogSecurityEvent(engine, event);
+        }
+
+        // Orders on closed accounts are dropped; others move to their next
+        // run even if this one failed.
+        if (result == ATM_ERROR_NOT_FOUND || result == ATM_ERROR_INVALID_ACCOUNT
+            || result == ATM_ERROR_INVALID_ORDER) {
+            order->state = ORDER_CANCELLED;
+        } else if (order->interval == 0) {
+            order->state = ORDER_FINISHED;
+        } else {
+            order->nextRun += order->interval;
+        }
+        ok = appendOrder(&engine->schedules, order) && ok;
+    }
+    ok = commitOrders(&engine->schedules) && ok;
+
+    for (int i = 0; i < batch->accountCount; i++) {
+        struct BatchAccount *entry = &batch->accounts[i];
+        ok = writeChange(engine, entry->index, &entry->before, &entry->acc) && ok;
+    }
+    ok = storeHeader(engine) && ok;
+    endUpdate(engine);
+    return ok ? ATM_OK : ATM_ERROR_IO;
+}
+
+// Runs every standing order that has come due, ORDER_BATCH at a time.
+// Orders missed while no engine was running are caught up one run at a time.
+enum AtmStatus atmRunDueOrders(struct AtmEngine *engine, struct AtmOrderRun *run) {
+    run->executed = 0;
+    run->failed = 0;
+
+    struct OrderBatch *batch = malloc(sizeof(struct OrderBatch));
+    if (batch == NULL) {
+        return ATM_ERROR_NO_MEMORY;
+    }
+    enum AtmStatus status = beginSchedules(engine);
+    if (status != ATM_OK) {
+        free(batch);
+        return status;
+    }
+
+    time_t now = time(NULL);
+    while (status == ATM_OK) {
+        const struct StandingOrder *due;
+
+        batch->orderCount = 0;
+        batch->accountCount = 0;
+        while (batch->orderCount < ORDER_BATCH && (due = nextDueOrder(&engine->schedules, now)) != NULL) {
+            batch->orders[batch->orderCount++] = *due;
+        }
+        if (batch->orderCount == 0) {
+            break;
+        }
+        status = runBatch(engine, batch, run);
+    }
+
+    endSchedules(engine);
+    free(batch);
+    return status;
+}
+
+void atmLogSecurityEvent(struct AtmEngine *engine, const char *eventDescription) {
+    char timeStr[20];
+    struct tm tm;
+
+    localTime(time(NULL), &tm);
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &tm);
+
+    lockStream(engine->securityLog);
+    fprintf(engine->securityLog, "%s - %s\n", timeStr, eventDescription);
+    unlockStream(engine->securityLog);
+}
+
+void atmGetStats(const struct AtmEngine *engine, struct AtmStats *stats) {
+    *stats = engine->stats;
+}
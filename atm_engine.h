@@ -0,0 +1,96 @@
+#ifndef ATM_ENGINE_H
+#define ATM_ENGINE_H
+
+#include <stdint.h>
+#include "account_file.h"
+#include "account_index.h"
+#include "scheduler.h"
+
+// Account engine shared by the console frontends, tools and servers. An
+// engine handle keeps the account file, journal and security log open and
+// owns the per-process caches (record slot hints, report indexes, withdrawal
+// windows, standing order wheel), so operations do not reopen files.
+// Operations return a status code and never print.
+//
+// The engine has no global state, so separate handles can be used from
+// separate threads. A single handle must not be used by two threads at once.
+// Writers on the shared account file are serialised with an exclusive file
+// lock held for the duration of each read-modify-write. The struct Account a
+// caller holds is a snapshot: balance changes are applied to the stored
+// record under the lock and the snapshot is refreshed from it.
+
+enum AtmStatus {
+    ATM_OK = 0,
+    ATM_ERROR_IO,                 // a file could not be opened, read or written
+    ATM_ERROR_LAYOUT,             // account file needs migrate_accounts
+    ATM_ERROR_NO_MEMORY,
+    ATM_ERROR_INVALID_ACCOUNT,    // account number empty or longer than 19 characters
+    ATM_ERROR_NOT_FOUND,
+    ATM_ERROR_EXISTS,
+    ATM_ERROR_BAD_PIN,            // PIN does not match
+    ATM_ERROR_LOCKED,             // PIN did not match and the account is locked
+    ATM_ERROR_INVALID_PIN,        // new PIN is not exactly 4 digits
+    ATM_ERROR_INVALID_AMOUNT,
+    ATM_ERROR_INSUFFICIENT_FUNDS,
+    ATM_ERROR_DAILY_LIMIT,
+    ATM_ERROR_INVALID_ORDER,      // unknown order kind, or a transfer to the same account
+    ATM_ERROR_ORDER_NOT_FOUND
+};
+
+// NULL paths take the defaults: FILE_NAME, "transactions.log", "security.log",
+// SCHEDULE_FILE_NAME.
+struct AtmConfig {
+    const char *accountPath;
+    const char *journalPath;
+    const char *securityLogPath;
+    const char *schedulePath;
+};
+
+// Cumulative time spent by one handle, for load testing.
+struct AtmStats {
+    double lockWaitSeconds;       // blocked acquiring the account file lock
+    double ioSeconds;             // reading and writing the account file and journal
+    long operations;
+};
+
+// Outcome of one atmRunDueOrders call. Failed runs are also written to the
+// security log.
+struct AtmOrderRun {
+    long executed;
+    long failed;
+};
+
+typedef int (*OrderVisitor)(const struct StandingOrder *order, void *context);
+
+struct AtmEngine;
+
+enum AtmStatus atmOpen(struct AtmEngine **engine, const struct AtmConfig *config);
+void atmClose(struct AtmEngine *engine);
+const char *atmStatusMessage(enum AtmStatus status);
+int atmValidPin(const char *pin);
+
+enum AtmStatus atmAccountExists(struct AtmEngine *engine, const char *accountNumber);
+enum AtmStatus atmCreateAccount(struct AtmEngine *engine, const char *accountNumber, const char *pin);
+enum AtmStatus atmLoadAccount(struct AtmEngine *engine, const char *accountNumber, struct Account *acc);
+enum AtmStatus atmLogin(struct AtmEngine *engine, const char *accountNumber, const char *pin, struct Account *acc);
+enum AtmStatus atmDeposit(struct AtmEngine *engine, struct Account *acc, int64_t amount);
+enum AtmStatus atmWithdraw(struct AtmEngine *engine, struct Account *acc, int64_t amount);
+enum AtmStatus atmCheckBalance(struct AtmEngine *engine, struct Account *acc);
+enum AtmStatus atmApplyInterest(struct AtmEngine *engine, struct Account *acc, int64_t *credited);
+enum AtmStatus atmChangePin(struct AtmEngine *engine, struct Account *acc, const char *currentPin, const char *newPin);
+enum AtmStatus atmRefreshAccount(struct AtmEngine *engine, struct Account *acc);
+enum AtmStatus atmDeleteAccount(struct AtmEngine *engine, const char *accountNumber);
+
+enum AtmStatus atmTopBalances(struct AtmEngine *engine, int count, IndexVisitor visit, void *context);
+enum AtmStatus atmBalancesBelow(struct AtmEngine *engine, int64_t below, IndexVisitor visit, void *context);
+enum AtmStatus atmDormantSince(struct AtmEngine *engine, int64_t cutoff, IndexVisitor visit, void *context);
+
+enum AtmStatus atmScheduleOrder(struct AtmEngine *engine, struct StandingOrder *order);
+enum AtmStatus atmCancelOrder(struct AtmEngine *engine, const char *accountNumber, uint32_t id);
+enum AtmStatus atmListOrders(struct AtmEngine *engine, const char *accountNumber, OrderVisitor visit, void *context);
+enum AtmStatus atmRunDueOrders(struct AtmEngine *engine, struct AtmOrderRun *run);
+
+void atmLogSecurityEvent(struct AtmEngine *engine, const char *eventDescription);
+void atmGetStats(const struct AtmEngine *engine, struct AtmStats *stats);
+
+#endif
@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "account_file.h"
+
+// Audits account balances against the transaction journal, and can rebuild
+// the account file from it.
+//
+// The journal is split into one byte range per thread. Each thread parses
+// its range and buckets entries by hash(account) into partitions; then each
+// thread replays one partition, taking entries from the ranges in journal
+// order so per-account ordering is kept. Replayed checking balances are
+// compared with the stored ones.
+//
+// The journal holds Deposit, Withdrawal, Payment (standing order debit) and
+// Interest entries on checking and a Closed marker when an account is
+// deleted. It records no savings movements, so savings balances are carried
+// over by -rebuild and not audited. Lines in the older format without an
+// account number are skipped, so accounts with history from before that
+// format will show up as discrepancies.
+//
+// Usage: audit_journal [-j journal] [-a account-file] [-t threads] [-rebuild new-file]
+// Exits 1 if any discrepancy is found.
+
+enum EntryKind { ENTRY_DEPOSIT, ENTRY_WITHDRAWAL, ENTRY_INTEREST, ENTRY_CLOSED };
+
+struct JournalEntry {
+    char accountNumber[20];
+    int32_t kind;
+    int64_t amount;      // cents
+};
+
+struct EntryList {
+    struct JournalEntry *items;
+    long count;
+    long capacity;
+};
+
+struct ReplayedAccount {
+    char accountNumber[20];
+    int used;
+    int64_t checking;
+    long entries;
+};
+
+struct BalanceMap {
+    struct ReplayedAccount *slots;
+    long capacity;       // power of two
+    long count;
+};
+
+struct ParseTask {
+    const char *begin;
+    const char *end;
+    int partitions;
+    struct EntryList *lists;   // one per partition
+    long parsed;
+    long skipped;
+};
+
+struct ReplayTask {
+    int partition;
+    int chunks;
+    struct ParseTask *parse;
+    struct BalanceMap map;
+};
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *checkedRealloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Out of memory");
+        exit(1);
+    }
+    return result;
+}
+
+static void appendEntry(struct EntryList *list, const struct JournalEntry *entry) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->items = checkedRealloc(list->items, list->capacity * sizeof(struct JournalEntry));
+    }
+    list->items[list->count++] = *entry;
+}
+
+// Slot from the high bits of a multiplicative hash, so it does not correlate
+// with the partition, which is taken from the low bits.
+static struct ReplayedAccount *findSlot(struct BalanceMap *map, const char *accountNumber, uint32_t hash) {
+    long mask = map->capacity - 1;
+    long i = (long)(((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+
+    while (map->slots[i].used && strcmp(map->slots[i].accountNumber, accountNumber) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &map->slots[i];
+}
+
+static struct ReplayedAccount *lookupAccount(struct BalanceMap *map, const char *accountNumber, int create) {
+    uint32_t hash = hashAccount(accountNumber);
+
+    if (create && (map->count + 1) * 2 > map->capacity) {
+        struct BalanceMap grown = { calloc(map->capacity * 2, sizeof(struct ReplayedAccount)), map->capacity * 2, map->count };
+        if (grown.slots == NULL) {
+            perror("Out of memory");
+            exit(1);
+        }
+        for (long i = 0; i < map->capacity; i++) {
+            if (map->slots[i].used) {
+                *findSlot(&grown, map->slots[i].accountNumber, hashAccount(map->slots[i].accountNumber)) = map->slots[i];
+            }
+        }
+        free(map->slots);
+        *map = grown;
+    }
+
+    struct ReplayedAccount *slot = findSlot(map, accountNumber, hash);
+    if (!slot->used) {
+        if (!create) {
+            return NULL;
+        }
+        strcpy(slot->accountNumber, accountNumber);
+        slot->used = 1;
+        map->count++;
+    }
+    return slot;
+}
+
+// Copies the next space-delimited token; returns the position after it.
+static const char *nextToken(const char *p, const char *end, char *out, size_t size) {
+    size_t n = 0;
+
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    while (p < end && *p != ' ' && *p != '\n') {
+        if (n + 1 < size) {
+            out[n++] = *p;
+        }
+        p++;
+    }
+    out[n] = '\0';
+    return p;
+}
+
+// Parses "123.45" into cents without going through floating point.
+static int parseCents(const char *text, int64_t *cents) {
+    int64_t whole = 0;
+    int fraction = 0, digits = 0;
+
+    if (*text == '\0') {
+        return 0;
+    }
+    for (; *text >= '0' && *text <= '9'; text++) {
+        whole = whole * 10 + (*text - '0');
+    }
+    if (*text == '.') {
+        for (text++; *text >= '0' && *text <= '9'; text++) {
+            if (digits < 2) {
+                fraction = fraction * 10 + (*text - '0');
+                digits++;
+            }
+        }
+    }
+    if (*text != '\0') {
+        return 0;
+    }
+    while (digits < 2) {
+        fraction *= 10;
+        digits++;
+    }
+    *cents = whole * 100 + fraction;
+    return 1;
+}
+
+static int parseLine(const char *p, const char *end, struct JournalEntry *entry) {
+    char type[16], amount[32];
+
+    memset(entry, 0, sizeof(struct JournalEntry));
+    p = nextToken(p, end, entry->accountNumber, sizeof(entry->accountNumber));
+    p = nextToken(p, end, type, sizeof(type));
+    nextToken(p, end, amount, sizeof(amount));
+
+    if (strcmp(type, "Deposit") == 0) {
+        entry->kind = ENTRY_DEPOSIT;
+    } else if (strcmp(type, "Withdrawal") == 0 || strcmp(type, "Payment") == 0) {
+        entry->kind = ENTRY_WITHDRAWAL;
+    } else if (strcmp(type, "Interest") == 0) {
+        entry->kind = ENTRY_INTEREST;
+    } else if (strcmp(type, "Closed") == 0) {
+        entry->kind = ENTRY_CLOSED;
+    } else {
+        return 0;
+    }
+    return entry->accountNumber[0] != '\0' && parseCents(amount, &entry->amount);
+}
+
+static void *parseChunk(void *arg) {
+    struct ParseTask *task = arg;
+    const char *p = task->begin;
+    struct JournalEntry entry;
+
+    while (p < task->end) {
+        const char *lineEnd = memchr(p, '\n', task->end - p);
+        if (lineEnd == NULL) {
+            lineEnd = task->end;
+        }
+        if (parseLine(p, lineEnd, &entry)) {
+            appendEntry(&task->lists[hashAccount(entry.accountNumber) % task->partitions], &entry);
+            task->parsed++;
+        } else if (lineEnd > p) {
+            task->skipped++;
+        }
+        p = lineEnd + 1;
+    }
+    return NULL;
+}
+
+static void *replayPartition(void *arg) {
+    struct ReplayTask *task = arg;
+
+    task->map.capacity = 1024;
+    task->map.slots = calloc(task->map.capacity, sizeof(struct ReplayedAccount));
+    if (task->map.slots == NULL) {
+        perror("Out of memory");
+        exit(1);
+    }
+
+    for (int c = 0; c < task->chunks; c++) {
+        const struct EntryList *list = &task->parse[c].lists[task->partition];
+        for (long i = 0; i < list->count; i++) {
+            const struct JournalEntry *entry = &list->items[i];
+            struct ReplayedAccount *acc = lookupAccount(&task->map, entry->accountNumber, 1);
+            switch (entry->kind) {
+                case ENTRY_DEPOSIT:
+                case ENTRY_INTEREST:
+                    acc->checking += entry->amount;
+                    break;
+                case ENTRY_WITHDRAWAL:
+                    acc->checking -= entry->amount;
+                    break;
+                case ENTRY_CLOSED:
+                    acc->checking = 0;
+                    break;
+            }
+            acc->entries++;
+        }
+    }
+    return NULL;
+}
+
+static char *readWholeFile(const char *path, long *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = malloc(*size > 0 ? *size : 1);
+    if (data == NULL || (long)fread(data, 1, *size, file) != *size) {
+        perror(path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char *argv[]) {
+    const char *journalPath = "transactions.log";
+    const char *accountPath = FILE_NAME;
+    const char *rebuildPath = NULL;
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = online > 0 ? (int)online : 1;
+
+    for (int i = 1; i < argc; i++) {
+        int hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-j") == 0 && hasValue) {
+            journalPath = argv[++i];
+        } else if (strcmp(argv[i], "-a") == 0 && hasValue) {
+            accountPath = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && hasValue) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-rebuild") == 0 && hasValue) {
+            rebuildPath = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-j journal] [-a account-file] [-t threads] [-rebuild new-file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (threads <= 0) {
+        threads = 1;
+    }
+    if (rebuildPath != NULL && strcmp(rebuildPath, accountPath) == 0) {
+        fprintf(stderr, "Rebuild to a new file, then replace %s with it.\n", accountPath);
+        return 2;
+    }
+
+    long size;
+    char *journal = readWholeFile(journalPath, &size);
+    if (journal == NULL) {
+        return 1;
+    }
+
+    struct ParseTask *parse = calloc(threads, sizeof(struct ParseTask));
+    struct ReplayTask *replay = calloc(threads, sizeof(struct ReplayTask));
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    if (parse == NULL || replay == NULL || ids == NULL) {
+        perror("Out of memory");
+        return 1;
+    }
+
+    // Chunk boundaries are moved forward to the start of the next line.
+    const char *end = journal + size;
+    const char *begin = journal;
+    for (int t = 0; t < threads; t++) {
+        const char *stop = t == threads - 1 ? end : journal + size / threads * (t + 1);
+        if (stop < begin) {
+            stop = begin;
+        }
+        while (stop < end && stop > journal && stop[-1] != '\n') {
+            stop++;
+        }
+        parse[t].begin = begin;
+        parse[t].end = stop;
+        parse[t].partitions = threads;
+        parse[t].lists = calloc(threads, sizeof(struct EntryList));
+        begin = stop;
+    }
+
+    double start = nowSeconds();
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&ids[t], NULL, parseChunk, &parse[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    double parsed = nowSeconds();
+    for (int t = 0; t < threads; t++) {
+        replay[t].partition = t;
+        replay[t].chunks = threads;
+        replay[t].parse = parse;
+        pthread_create(&ids[t], NULL, replayPartition, &replay[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    double finished = nowSeconds();
+
+    long entries = 0, skipped = 0;
+    for (int t = 0; t < threads; t++) {
+        entries += parse[t].parsed;
+        skipped += parse[t].skipped;
+    }
+    double elapsed = finished - start;
+    printf("journal %s: %ld entries (%ld lines skipped), %d threads\n", journalPath, entries, skipped, threads);
+    printf("parse %.3f s + replay %.3f s = %.3f s, %.0f entries/s\n",
+           parsed - start, finished - parsed, elapsed, elapsed > 0 ? entries / elapsed : 0.0);
+
+    // Compare with the stored balances, optionally writing the rebuilt file.
+    struct FileHeader header, rebuiltHeader;
+    struct Account acc;
+    long checked = 0, discrepancies = 0;
+
+    FILE *file = openAccountFile(accountPath, 0, &header);
+    if (file == NULL) {
+        printf("Cannot open %s\n", accountPath);
+        return 1;
+    }
+    FILE *rebuilt = NULL;
+    if (rebuildPath != NULL) {
+        rebuilt = createAccountFile(rebuildPath, &rebuiltHeader);
+        if (rebuilt == NULL) {
+            perror(rebuildPath);
+            return 1;
+        }
+    }
+
+    while (fread(&acc, sizeof(struct Account), 1, file)) {
+        int partition = (int)(hashAccount(acc.accountNumber) % threads);
+        struct ReplayedAccount *replayed = lookupAccount(&replay[partition].map, acc.accountNumber, 0);
+        int64_t expected = replayed != NULL ? replayed->checking : 0;
+
+        checked++;
+        if (expected != acc.checkingBalance) {
+            if (discrepancies == 0) {
+                printf("\n%-20s %15s %15s %15s\n", "account", "stored", "replayed", "difference");
+            }
+            printf("%-20s %15.2f %15.2f %15.2f\n", acc.accountNumber, acc.checkingBalance / 100.0,
+                   expected / 100.0, (acc.checkingBalance - expected) / 100.0);
+            discrepancies++;
+        }
+
+        if (rebuilt != NULL) {
+            acc.checkingBalance = expected;
+            fwrite(&acc, sizeof(struct Account), 1, rebuilt);
+            rebuiltHeader.recordCount++;
+            rebuiltHeader.checksum += recordChecksum(&acc);
+        }
+    }
+    fclose(file);
+
+    printf("\n%ld accounts checked, %ld discrepancies\n", checked, discrepancies);
+    if (rebuilt != NULL) {
+        int ok = writeHeader(rebuilt, &rebuiltHeader);
+        fclose(rebuilt);
+        if (!ok) {
+            printf("Error writing %s\n", rebuildPath);
+            return 1;
+        }
+        printf("Rebuilt checking balances written to %s\n", rebuildPath);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        for (int p = 0; p < threads; p++) {
+            free(parse[t].lists[p].items);
+        }
+        free(parse[t].lists);
+        free(replay[t].map.slots);
+    }
+    free(parse);
+    free(replay);
+    free(ids);
+    free(journal);
+    return discrepancies > 0 ? 1 : 0;
+}
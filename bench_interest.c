@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "account_file.h"
+#include "interest.h"
+
+// Measures what lazy accrual adds to the login/checkBalance path: the cost of
+// accrueInterest() per call, next to the record lookup that path already does.
+//
+// Usage: bench_interest [accounts] [lookups]
+
+#define BENCH_FILE "bench_accounts.dat"
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void makeAccount(struct Account *acc, int i, int64_t now) {
+    memset(acc, 0, sizeof(struct Account));
+    snprintf(acc->accountNumber, sizeof(acc->accountNumber), "%d", 100000 + i);
+    strcpy(acc->pin, "1234");
+    acc->rateTier = (uint8_t)(i % INTEREST_TIER_COUNT);
+    acc->checkingBalance = (int64_t)(rand() % 10000000);
+    acc->lastAccrualTime = (uint32_t)(now - rand() % SECONDS_PER_YEAR);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    int lookups = argc > 2 ? atoi(argv[2]) : 200;
+    int64_t now = time(NULL);
+    struct FileHeader header;
+    struct Account acc;
+
+    if (count <= 0 || lookups <= 0) {
+        fprintf(stderr, "Usage: %s [accounts] [lookups]\n", argv[0]);
+        return 2;
+    }
+
+    struct Account *accounts = malloc(sizeof(struct Account) * count);
+    if (accounts == NULL) {
+        return 1;
+    }
+
+    srand(42);
+    FILE *file = createAccountFile(BENCH_FILE, &header);
+    if (file == NULL) {
+        perror(BENCH_FILE);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        makeAccount(&accounts[i], i, now);
+        fwrite(&accounts[i], sizeof(struct Account), 1, file);
+        header.recordCount++;
+        header.checksum += recordChecksum(&accounts[i]);
+    }
+    writeHeader(file, &header);
+    fclose(file);
+
+    // Accrual alone, one call per account per round, advancing the clock a
+    // minute each round so every call does the full computation.
+    int rounds = 20;
+    int64_t credited = 0;
+    double start = nowSeconds();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) {
+            credited += accrueInterest(&accounts[i], now + 60 * (r + 1));
+        }
+    }
+    double accrualNs = (nowSeconds() - start) * 1e9 / ((double)rounds * count);
+
+    // The lookup login already performs: open the file and scan for the account.
+    start = nowSeconds();
+    for (int l = 0; l < lookups; l++) {
+        char target[20];
+        snprintf(target, sizeof(target), "%d", 100000 + rand() % count);
+        file = openAccountFile(BENCH_FILE, 0, &header);
+        while (fread(&acc, sizeof(struct Account), 1, file)) {
+            if (strcmp(acc.accountNumber, target) == 0) {
+                break;
+            }
+        }
+        fclose(file);
+    }
+    double lookupNs = (nowSeconds() - start) * 1e9 / lookups;
+
+    printf("accounts:            %d\n", count);
+    printf("accrueInterest:      %.1f ns/call (credited $%.2f total)\n", accrualNs, credited / 100.0);
+    printf("login lookup:        %.0f ns/lookup\n", lookupNs);
+    printf("accrual / lookup:    %.5f%%\n", 100.0 * accrualNs / lookupNs);
+
+    free(accounts);
+    remove(BENCH_FILE);
+    return 0;
+}
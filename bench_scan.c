@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "account_file.h"
+#include "account_scan.h"
+
+// Compares the original lookup loop (fread one struct, strcmp) with the
+// block scan in account_scan.c for each scanner the CPU supports. Lookups
+// target random accounts and run against a warm page cache, so the numbers
+// show CPU and copy cost rather than disk speed.
+//
+// Usage: bench_scan [accounts] [lookups]
+
+#define BENCH_FILE "bench_scan.dat"
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long recordLoop(FILE *file, const char *accNum, enum ScanKind kind) {
+    (void)kind;
+    struct Account acc;
+    long index = 0;
+
+    fseek(file, recordOffset(0), SEEK_SET);
+    while (fread(&acc, sizeof(struct Account), 1, file)) {
+        if (strcmp(acc.accountNumber, accNum) == 0) {
+            return index;
+        }
+        index++;
+    }
+    return -1;
+}
+
+static long blockScan(FILE *file, const char *accNum, enum ScanKind kind) {
+    return findAccountRecord(file, accNum, NULL, kind);
+}
+
+static void run(const char *name, long (*lookup)(FILE *, const char *, enum ScanKind), enum ScanKind kind,
+                int count, int lookups) {
+    struct FileHeader header;
+    char target[20];
+    long scanned = 0;
+
+    srand(7);
+    double start = nowSeconds();
+    for (int l = 0; l < lookups; l++) {
+        int wanted = rand() % count;
+        snprintf(target, sizeof(target), "%d", 1000000 + wanted);
+
+        FILE *file = openAccountFile(BENCH_FILE, 0, &header);
+        long index = lookup(file, target, kind);
+        fclose(file);
+
+        if (index != wanted) {
+            printf("%s: lookup of %s returned %ld\n", name, target, index);
+            exit(1);
+        }
+        scanned += index + 1;
+    }
+    double elapsed = nowSeconds() - start;
+
+    printf("%-14s %10.3f ms/lookup %10.1f MB/s\n", name, elapsed * 1e3 / lookups,
+           scanned * (double)sizeof(struct Account) / elapsed / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    int lookups = argc > 2 ? atoi(argv[2]) : 50;
+    struct FileHeader header;
+    struct Account acc;
+
+    if (count <= 0 || lookups <= 0) {
+        fprintf(stderr, "Usage: %s [accounts] [lookups]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = createAccountFile(BENCH_FILE, &header);
+    if (file == NULL) {
+        perror(BENCH_FILE);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        memset(&acc, 0, sizeof(struct Account));
+        snprintf(acc.accountNumber, sizeof(acc.accountNumber), "%d", 1000000 + i);
+        strcpy(acc.pin, "1234");
+        acc.checkingBalance = i;
+        fwrite(&acc, sizeof(struct Account), 1, file);
+        header.recordCount++;
+        header.checksum += recordChecksum(&acc);
+    }
+    writeHeader(file, &header);
+    fclose(file);
+
+    printf("%d accounts, %d random lookups\n", count, lookups);
+    run("fread+strcmp", recordLoop, SCAN_SCALAR, count, lookups);
+
+    const enum ScanKind kinds[] = { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        if (scanKindAvailable(kinds[k])) {
+            char name[32];
+            snprintf(name, sizeof(name), "block %s", scanKindName(kinds[k]));
+            run(name, blockScan, kinds[k], count, lookups);
+        }
+    }
+
+    remove(BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "interest.h"
+
+// Annual simple rate per tier, in basis points.
+static const int rateTiers[INTEREST_TIER_COUNT] = {
+    200,  // standard
+    300,  // preferred
+    450   // premium
+};
+
+int interestRateBps(int tier) {
+    if (tier < 0 || tier >= INTEREST_TIER_COUNT) {
+        return rateTiers[0];
+    }
+    return rateTiers[tier];
+}
+
+// Credits the whole cents of checking interest earned since the last accrual
+// and returns the amount credited. The clock only advances by the time that
+// earned those cents, so the sub-cent remainder keeps accruing on later reads.
+int64_t accrueInterest(struct Account *acc, int64_t now) {
+    if (acc->lastAccrualTime == 0 || acc->checkingBalance <= 0) {
+        acc->lastAccrualTime = (uint32_t)now;
+        return 0;
+    }
+
+    int64_t elapsed = now - (int64_t)acc->lastAccrualTime;
+    if (elapsed <= 0) {
+        return 0;
+    }
+
+    double perSecond = (double)acc->checkingBalance * interestRateBps(acc->rateTier) / (10000.0 * SECONDS_PER_YEAR);
+    int64_t interest = (int64_t)(perSecond * elapsed);
+    if (interest <= 0) {
+        return 0;
+    }
+
+    int64_t used = (int64_t)(interest / perSecond);
+    if (used > elapsed) {
+        used = elapsed;
+    }
+    acc->checkingBalance += interest;
+    acc->lastAccrualTime += (uint32_t)used;
+    return interest;
+}
+
+// Accrues up to now and restarts the clock. Call this before the balance
+// changes so the old balance stops earning; at most one cent is dropped.
+int64_t settleInterest(struct Account *acc, int64_t now) {
+    int64_t interest = accrueInterest(acc, now);
+    acc->lastAccrualTime = (uint32_t)now;
+    return interest;
+}
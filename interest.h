@@ -0,0 +1,17 @@
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include <stdint.h>
+#include "account_file.h"
+
+// Interest is accrued lazily: each account stores its rate tier and the time
+// interest was last credited, and the owed amount is computed whenever the
+// account is read or written. There is no periodic pass over the file.
+#define INTEREST_TIER_COUNT 3
+#define SECONDS_PER_YEAR (365L * 24 * 60 * 60)
+
+int interestRateBps(int tier);
+int64_t accrueInterest(struct Account *acc, int64_t now);
+int64_t settleInterest(struct Account *acc, int64_t now);
+
+#endif
@@ -0,0 +1,441 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "account_file.h"
+#include "atm_engine.h"
+
+// Multi-terminal load simulator. Each virtual terminal is a thread with its
+// own engine handle that runs scripted sessions through the same calls as
+// the console frontends:
+//
+//   login    atmLogin
+//   deposit  atmDeposit
+//   withdraw atmWithdraw (declined when funds or daily limits run out)
+//   logout   atmRefreshAccount
+//
+// Accounts are picked from a Zipf distribution so a few hot accounts see
+// most of the traffic. All terminals share one account file and journal, as
+// several ATMs on shared storage would, and the lock wait and I/O split comes
+// from each engine's statistics. After the run every stored balance is
+// checked against a replay of the journal, so lost updates under contention
+// fail the run instead of hiding behind good throughput numbers. The
+// simulator works on its own files and never touches accounts.txt.
+//
+// Usage: loadsim [-t terminals] [-a accounts] [-s sessions] [-o ops]
+//                [-z zipf-exponent] [-k think-ms] [-keep]
+
+#define SIM_ACCOUNTS "loadsim_accounts.dat"
+#define SIM_JOURNAL "loadsim_transactions.log"
+#define SIM_SECURITY_LOG "loadsim_security.log"
+#define SIM_SCHEDULES "loadsim_schedules.dat"
+#define OPENING_BALANCE 100000       // cents, journalled as a Deposit
+#define MAX_MISMATCHES_SHOWN 10
+
+enum { OP_LOGIN, OP_DEPOSIT, OP_WITHDRAW, OP_LOGOUT, OP_SESSION, OP_KINDS };
+
+static const char *opNames[OP_KINDS] = { "login", "deposit", "withdraw", "logout", "session" };
+
+struct SimConfig {
+    int terminals;
+    int accounts;
+    int sessions;     // per terminal
+    int ops;          // deposits/withdrawals per session
+    double zipf;
+    double thinkMs;   // mean think time between steps
+    int keepFiles;
+};
+
+struct Terminal {
+    struct AtmEngine *engine;
+    unsigned int seed;
+    const struct SimConfig *config;
+    const double *zipfCdf;
+    double *latency[OP_KINDS];   // seconds, one entry per completed step
+    int latencyCount[OP_KINDS];
+    double lockWait;             // from the engine's statistics
+    double ioTime;
+    double thinkTime;
+    int failedWithdrawals;
+};
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double randomUnit(unsigned int *seed) {
+    return (rand_r(seed) + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static void accountName(char *out, int index) {
+    snprintf(out, 20, "%d", 500000 + index);
+}
+
+// Cumulative Zipf probabilities for ranks 1..n; rank r gets weight 1/r^s.
+static double *buildZipfCdf(int n, double s) {
+    double *cdf = malloc(sizeof(double) * n);
+    double total = 0;
+
+    if (cdf == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        total += 1.0 / pow(i + 1, s);
+        cdf[i] = total;
+    }
+    for (int i = 0; i < n; i++) {
+        cdf[i] /= total;
+    }
+    return cdf;
+}
+
+static int pickAccount(struct Terminal *term) {
+    double u = randomUnit(&term->seed);
+    int lo = 0, hi = term->config->accounts - 1;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (term->zipfCdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void think(struct Terminal *term) {
+    if (term->config->thinkMs <= 0) {
+        return;
+    }
+
+    double ms = -log(randomUnit(&term->seed)) * term->config->thinkMs;
+    struct timespec ts = { (time_t)(ms / 1000), (long)(fmod(ms, 1000) * 1e6) };
+    double start = nowSeconds();
+    nanosleep(&ts, NULL);
+    term->thinkTime += nowSeconds() - start;
+}
+
+static void record(struct Terminal *term, int op, double seconds) {
+    term->latency[op][term->latencyCount[op]++] = seconds;
+}
+
+static void runSession(struct Terminal *term) {
+    char accNum[20];
+    struct Account acc;
+
+    accountName(accNum, pickAccount(term));
+    double sessionStart = nowSeconds();
+    double thinkBefore = term->thinkTime;
+
+    double start = nowSeconds();
+    if (atmLogin(term->engine, accNum, "1234", &acc) != ATM_OK) {
+        return;
+    }
+    record(term, OP_LOGIN, nowSeconds() - start);
+
+    for (int i = 0; i < term->config->ops; i++) {
+        think(term);
+        int64_t amount = 100 + rand_r(&term->seed) % 20000;
+        start = nowSeconds();
+        if (rand_r(&term->seed) % 2 == 0) {
+            atmDeposit(term->engine, &acc, amount);
+            record(term, OP_DEPOSIT, nowSeconds() - start);
+        } else {
+            if (atmWithdraw(term->engine, &acc, amount) != ATM_OK) {
+                term->failedWithdrawals++;
+            }
+            record(term, OP_WITHDRAW, nowSeconds() - start);
+        }
+    }
+
+    think(term);
+    start = nowSeconds();
+    atmRefreshAccount(term->engine, &acc);
+    record(term, OP_LOGOUT, nowSeconds() - start);
+
+    record(term, OP_SESSION, nowSeconds() - sessionStart - (term->thinkTime - thinkBefore));
+}
+
+static void *runTerminal(void *arg) {
+    struct Terminal *term = arg;
+
+    for (int i = 0; i < term->config->sessions; i++) {
+        runSession(term);
+    }
+    return NULL;
+}
+
+// Creates the scratch account file and a journal holding each account's
+// opening balance, so a replay of the journal accounts for every cent.
+static int setUpAccounts(const struct SimConfig *config) {
+    struct FileHeader header;
+    struct Account acc;
+    char date[32];
+
+    FILE *file = createAccountFile(SIM_ACCOUNTS, &header);
+    if (file == NULL) {
+        perror(SIM_ACCOUNTS);
+        return 0;
+    }
+    FILE *journal = fopen(SIM_JOURNAL, "w");
+    if (journal == NULL) {
+        perror(SIM_JOURNAL);
+        fclose(file);
+        return 0;
+    }
+
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Y", localtime(&now));
+
+    for (int i = 0; i < config->accounts; i++) {
+        memset(&acc, 0, sizeof(struct Account));
+        accountName(acc.accountNumber, i);
+        strcpy(acc.pin, "1234");
+        acc.checkingBalance = OPENING_BALANCE;
+        acc.lastAccrualTime = (uint32_t)now;
+        fwrite(&acc, sizeof(struct Account), 1, file);
+        header.recordCount++;
+        header.checksum += recordChecksum(&acc);
+        fprintf(journal, "%s Deposit %.2f %lld %s\n", acc.accountNumber, OPENING_BALANCE / 100.0,
+                (long long)now, date);
+    }
+
+    int ok = writeHeader(file, &header);
+    fclose(file);
+    ok = fclose(journal) == 0 && ok;
+    return ok;
+}
+
+// Replays the journal and compares every stored checking balance with it.
+// Returns the number of accounts that disagree, or -1 if a file could not
+// be read.
+static int checkBalances(const struct SimConfig *config) {
+    struct FileHeader header;
+    struct Account acc;
+    char line[160], accNum[20], type[16];
+    long long whole;
+    int cents, mismatches = 0;
+
+    int64_t *replayed = calloc(config->accounts, sizeof(int64_t));
+    FILE *journal = fopen(SIM_JOURNAL, "r");
+    if (replayed == NULL || journal == NULL) {
+        free(replayed);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), journal) != NULL) {
+        if (sscanf(line, "%19s %15s %lld.%2d", accNum, type, &whole, &cents) != 4) {
+            continue;
+        }
+        long index = strtol(accNum, NULL, 10) - 500000;
+        if (index < 0 || index >= config->accounts) {
+            continue;
+        }
+        int64_t amount = whole * 100 + cents;
+        if (strcmp(type, "Withdrawal") == 0 || strcmp(type, "Payment") == 0) {
+            replayed[index] -= amount;
+        } else if (strcmp(type, "Deposit") == 0 || strcmp(type, "Interest") == 0) {
+            replayed[index] += amount;
+        }
+    }
+    fclose(journal);
+
+    FILE *file = openAccountFile(SIM_ACCOUNTS, 0, &header);
+    if (file == NULL) {
+        free(replayed);
+        return -1;
+    }
+    while (fread(&acc, sizeof(struct Account), 1, file) == 1) {
+        long index = strtol(acc.accountNumber, NULL, 10) - 500000;
+        if (index < 0 || index >= config->accounts || acc.checkingBalance == replayed[index]) {
+            continue;
+        }
+        if (++mismatches <= MAX_MISMATCHES_SHOWN) {
+            printf("account %s: stored %.2f, journal %.2f\n", acc.accountNumber,
+                   acc.checkingBalance / 100.0, replayed[index] / 100.0);
+        }
+    }
+    fclose(file);
+    free(replayed);
+    return mismatches;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+    int index = (int)ceil(p / 100.0 * n) - 1;
+    if (index < 0) {
+        index = 0;
+    }
+    return sorted[index];
+}
+
+static void report(const struct SimConfig *config, struct Terminal *terms, double elapsed) {
+    double lockWait = 0, ioTime = 0;
+    int failedWithdrawals = 0;
+
+    for (int t = 0; t < config->terminals; t++) {
+        lockWait += terms[t].lockWait;
+        ioTime += terms[t].ioTime;
+        failedWithdrawals += terms[t].failedWithdrawals;
+    }
+
+    int sessions = 0, ops = 0;
+    printf("terminals %d, accounts %d (zipf s=%.2f), think %.1f ms\n",
+           config->terminals, config->accounts, config->zipf, config->thinkMs);
+    printf("\n%-10s %8s %9s %9s %9s %9s %9s\n", "latency", "count", "p50 ms", "p95 ms", "p99 ms", "p99.9 ms", "max ms");
+
+    for (int op = 0; op < OP_KINDS; op++) {
+        int n = 0;
+        for (int t = 0; t < config->terminals; t++) {
+            n += terms[t].latencyCount[op];
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        double *all = malloc(sizeof(double) * n);
+        int k = 0;
+        for (int t = 0; t < config->terminals; t++) {
+            memcpy(all + k, terms[t].latency[op], sizeof(double) * terms[t].latencyCount[op]);
+            k += terms[t].latencyCount[op];
+        }
+        qsort(all, n, sizeof(double), compareDoubles);
+        printf("%-10s %8d %9.3f %9.3f %9.3f %9.3f %9.3f\n", opNames[op], n,
+               percentile(all, n, 50) * 1e3, percentile(all, n, 95) * 1e3, percentile(all, n, 99) * 1e3,
+               percentile(all, n, 99.9) * 1e3, all[n - 1] * 1e3);
+        free(all);
+
+        if (op == OP_SESSION) {
+            sessions = n;
+        } else if (op != OP_LOGIN && op != OP_LOGOUT) {
+            ops += n;
+        }
+    }
+
+    double busy = 0;
+    for (int t = 0; t < config->terminals; t++) {
+        for (int i = 0; i < terms[t].latencyCount[OP_SESSION]; i++) {
+            busy += terms[t].latency[OP_SESSION][i];
+        }
+    }
+
+    printf("\nelapsed %.2f s: %.1f sessions/s, %.1f transactions/s (%d withdrawals declined)\n",
+           elapsed, sessions / elapsed, ops / elapsed, failedWithdrawals);
+    if (sessions > 0 && busy > 0) {
+        printf("per session (excl. think): %.3f ms total = lock wait %.3f ms (%.1f%%) + I/O %.3f ms (%.1f%%) + other %.3f ms\n",
+               busy / sessions * 1e3, lockWait / sessions * 1e3, 100 * lockWait / busy,
+               ioTime / sessions * 1e3, 100 * ioTime / busy, (busy - lockWait - ioTime) / sessions * 1e3);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    struct SimConfig config = { 200, 1000, 10, 3, 1.0, 5.0, 0 };
+
+    for (int i = 1; i < argc; i++) {
+        int hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-t") == 0 && hasValue) {
+            config.terminals = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-a") == 0 && hasValue) {
+            config.accounts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && hasValue) {
+            config.sessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && hasValue) {
+            config.ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-z") == 0 && hasValue) {
+            config.zipf = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && hasValue) {
+            config.thinkMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-keep") == 0) {
+            config.keepFiles = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-t terminals] [-a accounts] [-s sessions] [-o ops] "
+                            "[-z zipf-exponent] [-k think-ms] [-keep]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (config.terminals <= 0 || config.accounts <= 0 || config.sessions <= 0 || config.ops < 0) {
+        fprintf(stderr, "Terminals, accounts and sessions must be positive.\n");
+        return 2;
+    }
+
+    double *cdf = buildZipfCdf(config.accounts, config.zipf);
+    struct Terminal *terms = calloc(config.terminals, sizeof(struct Terminal));
+    pthread_t *threads = malloc(sizeof(pthread_t) * config.terminals);
+    if (cdf == NULL || terms == NULL || threads == NULL || !setUpAccounts(&config)) {
+        return 1;
+    }
+
+    struct AtmConfig engineConfig = { SIM_ACCOUNTS, SIM_JOURNAL, SIM_SECURITY_LOG, SIM_SCHEDULES };
+    for (int t = 0; t < config.terminals; t++) {
+        enum AtmStatus status = atmOpen(&terms[t].engine, &engineConfig);
+        if (status != ATM_OK) {
+            fprintf(stderr, "Terminal %d: %s\n", t, atmStatusMessage(status));
+            return 1;
+        }
+        terms[t].seed = 1234u + t;
+        terms[t].config = &config;
+        terms[t].zipfCdf = cdf;
+        for (int op = 0; op < OP_KINDS; op++) {
+            int perSession = (op == OP_DEPOSIT || op == OP_WITHDRAW) ? config.ops : 1;
+            terms[t].latency[op] = malloc(sizeof(double) * (config.sessions * perSession + 1));
+        }
+    }
+
+    double start = nowSeconds();
+    for (int t = 0; t < config.terminals; t++) {
+        pthread_create(&threads[t], NULL, runTerminal, &terms[t]);
+    }
+    for (int t = 0; t < config.terminals; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = nowSeconds() - start;
+
+    for (int t = 0; t < config.terminals; t++) {
+        struct AtmStats stats;
+        atmGetStats(terms[t].engine, &stats);
+        terms[t].lockWait = stats.lockWaitSeconds;
+        terms[t].ioTime = stats.ioSeconds;
+        atmClose(terms[t].engine);
+    }
+
+    report(&config, terms, elapsed);
+    int failed = 0;
+    if (!verifyAccountFile(SIM_ACCOUNTS)) {
+        printf("Account file failed verification after the run!\n");
+        failed = 1;
+    }
+    int mismatches = checkBalances(&config);
+    if (mismatches < 0) {
+        printf("Could not replay %s against %s!\n", SIM_JOURNAL, SIM_ACCOUNTS);
+        failed = 1;
+    } else if (mismatches > 0) {
+        printf("%d account(s) disagree with the journal: updates were lost!\n", mismatches);
+        failed = 1;
+    } else {
+        printf("all %d balances match the journal\n", config.accounts);
+    }
+
+    for (int t = 0; t < config.terminals; t++) {
+        for (int op = 0; op < OP_KINDS; op++) {
+            free(terms[t].latency[op]);
+        }
+    }
+    free(terms);
+    free(threads);
+    free(cdf);
+    if (!config.keepFiles) {
+        remove(SIM_ACCOUNTS);
+        remove(SIM_JOURNAL);
+        remove(SIM_SECURITY_LOG);
+        remove(SIM_SCHEDULES);
+    }
+    return failed;
+}
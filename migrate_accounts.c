@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "account_file.h"
+
+// Offline converter from the original headerless account file, which was a
+// raw fwrite of the old struct:
+//
+//   char accountNumber[20]; char pin[10]; float checkingBalance;
+//   float savingsBalance; int failedLoginAttempts; time_t lastLoginTime;
+//
+// With a 64-bit time_t (Linux, 64-bit Windows) that struct is 56 bytes; with
+// a 32-bit time_t it is 48. Fields are read by offset so the result does not
+// depend on the compiler running this tool.
+//
+// Usage:
+//   migrate_accounts <legacy-file> <new-file> [--time32]
+//   migrate_accounts --verify <file>
+
+#define LEGACY_RECORD_SIZE 56
+#define LEGACY_RECORD_SIZE_TIME32 48
+
+static int64_t toCents(float amount) {
+    return (int64_t)(amount * 100.0 + (amount < 0 ? -0.5 : 0.5));
+}
+
+// Copies a legacy string field up to its NUL. Old records can hold garbage
+// after the NUL, which must not reach the zero-padded new record.
+static void copyField(char *dest, const unsigned char *src, size_t size) {
+    size_t length = strnlen((const char *)src, size - 1);
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+}
+
+static void convertRecord(const unsigned char *raw, int time32, struct Account *acc) {
+    float checking, savings;
+    int32_t failed;
+
+    memset(acc, 0, sizeof(struct Account));
+    copyField(acc->accountNumber, raw, sizeof(acc->accountNumber));
+    copyField(acc->pin, raw + 20, sizeof(acc->pin));
+
+    memcpy(&checking, raw + 32, sizeof(float));
+    memcpy(&savings, raw + 36, sizeof(float));
+    memcpy(&failed, raw + 40, sizeof(int32_t));
+    acc->checkingBalance = toCents(checking);
+    acc->savingsBalance = toCents(savings);
+    acc->failedLoginAttempts = failed;
+
+    if (time32) {
+        int32_t lastLogin;
+        memcpy(&lastLogin, raw + 44, sizeof(int32_t));
+        acc->lastLoginTime = lastLogin;
+    } else {
+        memcpy(&acc->lastLoginTime, raw + 48, sizeof(int64_t));
+    }
+}
+
+static int migrate(const char *inPath, const char *outPath, int time32) {
+    unsigned char raw[LEGACY_RECORD_SIZE];
+    size_t recordSize = time32 ? LEGACY_RECORD_SIZE_TIME32 : LEGACY_RECORD_SIZE;
+    struct FileHeader header;
+    struct Account acc;
+
+    FILE *in = fopen(inPath, "rb");
+    if (in == NULL) {
+        perror(inPath);
+        return 0;
+    }
+
+    if (readHeader(in, &header)) {
+        printf("%s is already in the current layout.\n", inPath);
+        fclose(in);
+        return 0;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if (size < 0 || size % recordSize != 0) {
+        printf("%s is %ld bytes, not a whole number of %zu-byte legacy records.\n", inPath, size, recordSize);
+        if (!time32 && size > 0 && size % LEGACY_RECORD_SIZE_TIME32 == 0) {
+            printf("It may have been written with a 32-bit time_t; try --time32.\n");
+        }
+        fclose(in);
+        return 0;
+    }
+
+    FILE *out = createAccountFile(outPath, &header);
+    if (out == NULL) {
+        perror(outPath);
+        fclose(in);
+        return 0;
+    }
+
+    while (fread(raw, recordSize, 1, in)) {
+        convertRecord(raw, time32, &acc);
+        fwrite(&acc, sizeof(struct Account), 1, out);
+        header.recordCount++;
+        header.checksum += recordChecksum(&acc);
+    }
+
+    int ok = writeHeader(out, &header);
+    fclose(in);
+    fclose(out);
+
+    if (!ok) {
+        printf("Error writing %s\n", outPath);
+        return 0;
+    }
+
+    printf("Migrated %u accounts from %s to %s\n", header.recordCount, inPath, outPath);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0) {
+        if (!verifyAccountFile(argv[2])) {
+            return 1;
+        }
+        printf("%s is consistent.\n", argv[2]);
+        return 0;
+    }
+
+    if (argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "--time32") != 0)) {
+        fprintf(stderr, "Usage: %s <legacy-file> <new-file> [--time32]\n", argv[0]);
+        fprintf(stderr, "       %s --verify <file>\n", argv[0]);
+        return 2;
+    }
+
+    if (strcmp(argv[1], argv[2]) == 0) {
+        fprintf(stderr, "Write the migrated file to a new path, then replace %s with it.\n", FILE_NAME);
+        return 2;
+    }
+
+    return migrate(argv[1], argv[2], argc == 4) ? 0 : 1;
+}
@@ -3,25 +3,23 @@
 #include <string.h>
 #include <conio.h>
 #include <time.h>
-#include <windows.h>
-
-#define FILE_NAME "accounts.txt"
-
-struct Account {
-    char accountNumber[20];
-    char pin[10];
-    float checkingBalance;
-    float savingsBalance;
-    int failedLoginAttempts;
-    time_t lastLoginTime;
+#include <stdint.h>
+#include "atm_engine.h"
+#include "interest.h"
+#include "velocity.h"
+
+struct ReportQuery {
+    int isTime;
+    int shown;
 };
 
-struct Transaction {
-    char type[10]; 
-    float amount;
-    time_t timestamp;
+struct OrderList {
+    const char *accountNumber;   // whose orders are listed
+    int shown;
 };
 
+struct AtmEngine *engine;
+
 
 void createAccount();
 void login();
@@ -29,28 +27,36 @@ void atmMenu(struct Account *acc);
 void deposit(struct Account *acc);
 void withdraw(struct Account *acc);
 void checkBalance(struct Account *acc);
-void updateAccount(struct Account *acc);
-int accountExists(char *accNum);
-void getSecureInput(char *input, int length);
-void logTransaction(struct Transaction trans);
 void applyInterest(struct Account *acc);
 void changePin(struct Account *acc);
-void deleteAccount(char *accountNumber);
-void logSecurityEvent(const char *eventDescription);
-int checkLoginAttempts(struct Account *acc);
-void lockFile(FILE *logFile);
-void unlockFile(FILE *logFile);
-
+int deleteAccount(char *accountNumber);
+void logout(struct Account *acc);
+void standingOrders(struct Account *acc);
+void newStandingOrder(struct Account *acc);
+int printOrder(const struct StandingOrder *order, void *context);
+void runStandingOrders();
+void getSecureInput(char *input, int length);
+void accountReports();
+int printReportEntry(const struct IndexEntry *entry, void *context);
 
 // Main function
 int main() {
     int choice;
 
+    enum AtmStatus status = atmOpen(&engine, NULL);
+    if (status != ATM_OK) {
+        printf("%s!\n", atmStatusMessage(status));
+        return 1;
+    }
+
     do {
+        runStandingOrders();
+
         printf("\n------ ATM System ------\n");
         printf("1. Create Account\n");
         printf("2. Login\n");
-        printf("3. Exit\n");
+        printf("3. Account Reports\n");
+        printf("4. Exit\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
         getchar(); 
@@ -63,74 +69,47 @@ int main() {
                 login();
                 break;
             case 3:
+                accountReports();
+                break;
+            case 4:
                 printf("Exiting... Thank you!\n");
                 break;
             default:
                 printf("Invalid choice! Try again.\n");
         }
-    } while(choice != 3);
+    } while(choice != 4);
 
-    return 0;
-}
-
-// Function to check if account exists
-int accountExists(char *accNum) {
-    struct Account temp;
-    FILE *file = fopen(FILE_NAME, "r");
-    
-    if (file == NULL) {
-        return 0; //Account does not exist
-    }
-
-    while (fread(&temp, sizeof(struct Account), 1, file)) {
-        if (strcmp(temp.accountNumber, accNum) == 0) {
-            fclose(file);
-            return 1; // Account exists
-        }
-    }
-
-    fclose(file);
+    atmClose(engine);
     return 0;
 }
 
 void createAccount() {
-    struct Account acc;
-    FILE *file = fopen(FILE_NAME, "a");
-
-    if (file == NULL) {
-        printf("Error opening file!\n");
-        return;
-    }
+    char accNum[20], pin[10];
 
     printf("Enter Account Number: ");
-    scanf("%19s", acc.accountNumber);
+    scanf("%19s", accNum);
     getchar(); 
 
-    if (accountExists(acc.accountNumber)) {
+    if (atmAccountExists(engine, accNum) == ATM_OK) {
         printf("Account number already exists! Try a different one.\n");
-        fclose(file);
         return;
     }
 
     do {
         printf("Set a 4-digit PIN: ");
-        getSecureInput(acc.pin, 10);  
+        getSecureInput(pin, 10);  
         
-        if (strlen(acc.pin) != 4 || strspn(acc.pin, "0123456789") != 4) {
+        if (!atmValidPin(pin)) {
             printf("Invalid PIN! Please enter exactly 4 digits.\n");
         }
-    } while (strlen(acc.pin) != 4 || strspn(acc.pin, "0123456789") != 4);
-
-    acc.checkingBalance = 0.0;
-    acc.savingsBalance = 0.0; 
-    acc.failedLoginAttempts = 0;
-
-    fwrite(&acc, sizeof(struct Account), 1, file);
-    fclose(file);
-
-    printf("Account created successfully!\n");
+    } while (!atmValidPin(pin));
 
-   
+    enum AtmStatus status = atmCreateAccount(engine, accNum, pin);
+    if (status == ATM_OK) {
+        printf("Account created successfully!\n");
+    } else {
+        printf("%s!\n", atmStatusMessage(status));
+    }
 }
 
 
@@ -138,7 +117,6 @@ void createAccount() {
 void login() {
     struct Account acc;
     char accNum[20], pin[10];
-    int found = 0;
 
     printf("Enter Account Number: ");
     scanf("%19s", accNum);
@@ -147,64 +125,99 @@ void login() {
     printf("Enter PIN: ");
     getSecureInput(pin, 10);
 
-    FILE *file = fopen(FILE_NAME, "r+");
-    if (file == NULL) {
-        printf("No accounts found! Please create an account first.\n");
-        return;
-    }
-
-    while (fread(&acc, sizeof(struct Account), 1, file)) {
-       
-
-        if (strcmp(acc.accountNumber, accNum) == 0 && strcmp(acc.pin, pin) == 0) {
-            found = 1;
-            acc.failedLoginAttempts = 0; 
-            acc.lastLoginTime = time(NULL); 
-            fseek(file, -sizeof(struct Account), SEEK_CUR); 
-            fwrite(&acc, sizeof(struct Account), 1, file); 
+    enum AtmStatus status = atmLogin(engine, accNum, pin, &acc);
+    switch (status) {
+        case ATM_OK:
             printf("Login successful!\n");
             atmMenu(&acc);
-            return;
-        }
+            break;
+        case ATM_ERROR_LOCKED:
+            printf("Invalid account number or PIN!\n");
+            printf("Account locked due to multiple failed login attempts!, try again after 30 mintutes \n");
+            break;
+        case ATM_ERROR_NOT_FOUND:
+        case ATM_ERROR_BAD_PIN:
+        case ATM_ERROR_INVALID_ACCOUNT:
+            printf("Invalid account number or PIN!\n");
+            break;
+        default:
+            printf("%s!\n", atmStatusMessage(status));
     }
+}
+
+
+// Ops queries answered from the balance and last-login indexes.
+void accountReports() {
+    int choice;
+    double amount;
+    int count;
+    enum AtmStatus status;
+    struct ReportQuery query;
 
-    fclose(file);
+    do {
+        printf("\n------ Account Reports ------\n");
+        printf("1. Top Checking Balances\n");
+        printf("2. Checking Balance Below Amount\n");
+        printf("3. Dormant Accounts\n");
+        printf("4. Back\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        getchar();
 
-    if (!found) {
-        printf("Invalid account number or PIN!\n");
+        memset(&query, 0, sizeof(query));
+        status = ATM_OK;
 
-        file = fopen(FILE_NAME, "r+");
-        while (fread(&acc, sizeof(struct Account), 1, file)) {
-            if (strcmp(acc.accountNumber, accNum) == 0) {
-                acc.failedLoginAttempts++;
-                fseek(file, -sizeof(struct Account), SEEK_CUR);
-                fwrite(&acc, sizeof(struct Account), 1, file);
+        switch(choice) {
+            case 1:
+                printf("How many accounts: ");
+                scanf("%d", &count);
+                getchar();
+                status = atmTopBalances(engine, count, printReportEntry, &query);
                 break;
-            }
+            case 2:
+                printf("Show balances below: ");
+                scanf("%lf", &amount);
+                getchar();
+                status = atmBalancesBelow(engine, (int64_t)(amount * 100.0 + 0.5), printReportEntry, &query);
+                break;
+            case 3:
+                printf("Not logged in for how many months: ");
+                scanf("%d", &count);
+                getchar();
+                query.isTime = 1;
+                status = atmDormantSince(engine, time(NULL) - (int64_t)count * (SECONDS_PER_YEAR / 12),
+                                         printReportEntry, &query);
+                break;
+            case 4:
+                break;
+            default:
+                printf("Invalid choice! Try again.\n");
         }
-        fclose(file);
 
-        
-        if (checkLoginAttempts(&acc)) {
-            printf("Account locked due to multiple failed login attempts!, try again after 30 mintutes \n");
+        if (status != ATM_OK) {
+            printf("%s!\n", atmStatusMessage(status));
+        } else if (choice >= 1 && choice <= 3) {
+            printf("%d account(s).\n", query.shown);
         }
-    }
+    } while(choice != 4);
 }
 
+int printReportEntry(const struct IndexEntry *entry, void *context) {
+    struct ReportQuery *query = context;
 
-
-
-int checkLoginAttempts(struct Account *acc) {
-    if (acc->failedLoginAttempts >= 3) {
-        time_t currentTime = time(NULL);
-        if (difftime(currentTime, acc->lastLoginTime) > 1800) {
-            
-            acc->failedLoginAttempts = 0;
-            return 0;
-        }
-        return 1; 
+    if (!query->isTime) {
+        printf("%-20s $%.2f\n", entry->accountNumber, entry->key / 100.0);
+    } else if (entry->key == 0) {
+        printf("%-20s never logged in\n", entry->accountNumber);
+    } else {
+        char timeStr[20];
+        time_t when = (time_t)entry->key;
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M", localtime(&when));
+        printf("%-20s last login %s\n", entry->accountNumber, timeStr);
     }
-    return 0; 
+
+    query->shown++;
+    return 1;
 }
 
 
@@ -219,7 +232,8 @@ void atmMenu(struct Account *acc) {
         printf("4. Change PIN\n");
         printf("5. Apply Interest\n");
         printf("6. Delete Account\n");
-        printf("7. Logout\n");
+        printf("7. Standing Orders\n");
+        printf("8. Logout\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
         getchar();
@@ -241,30 +255,33 @@ void atmMenu(struct Account *acc) {
                 applyInterest(acc);
                 break;
             case 6:
-                deleteAccount(acc->accountNumber);
+                if (deleteAccount(acc->accountNumber)) {
+                    return; // nothing left to log out of
+                }
                 break;
             case 7:
-                updateAccount(acc);
-                printf("Logging out...\n");
+                standingOrders(acc);
+                break;
+            case 8:
+                logout(acc);
                 break;
             default:
                 printf("Invalid choice! Try again.\n");
         }
-    } while(choice != 7);
+    } while(choice != 8);
 }
 
 
 void deposit(struct Account *acc) {
-    float amount;
+    double input;
     printf("Enter amount to deposit: ");
-    scanf("%f", &amount);
+    scanf("%lf", &input);
     getchar();
 
-    if (amount > 0) {
-        acc->checkingBalance += amount;
-        struct Transaction trans = {"Deposit", amount, time(NULL)};
-        logTransaction(trans);
-        printf("Deposit successful! New checking balance: $%.2f\n", acc->checkingBalance);
+    int64_t amount = input > 0 ? (int64_t)(input * 100.0 + 0.5) : 0;
+
+    if (atmDeposit(engine, acc, amount) == ATM_OK) {
+        printf("Deposit successful! New checking balance: $%.2f\n", acc->checkingBalance / 100.0);
     } else {
         printf("Invalid amount!\n");
     }
@@ -272,31 +289,39 @@ void deposit(struct Account *acc) {
 
 
 void withdraw(struct Account *acc) {
-    float amount;
+    double input;
     printf("Enter amount to withdraw: ");
-    scanf("%f", &amount);
+    scanf("%lf", &input);
     getchar();
 
-    if (amount > 0 && amount <= acc->checkingBalance) {
-        acc->checkingBalance -= amount;
-        struct Transaction trans = {"Withdrawal", amount, time(NULL)};
-        logTransaction(trans);
-        printf("Withdrawal successful! New checking balance: $%.2f\n", acc->checkingBalance);
-    } else {
-        printf("Insufficient balance or invalid amount!\n");
+    int64_t amount = input > 0 ? (int64_t)(input * 100.0 + 0.5) : 0;
+
+    switch (atmWithdraw(engine, acc, amount)) {
+        case ATM_OK:
+            printf("Withdrawal successful! New checking balance: $%.2f\n", acc->checkingBalance / 100.0);
+            break;
+        case ATM_ERROR_DAILY_LIMIT:
+            printf("Daily withdrawal limit reached! Limit is $%.2f in up to %d withdrawals per 24 hours.\n",
+                   DAILY_WITHDRAWAL_LIMIT / 100.0, DAILY_WITHDRAWAL_COUNT);
+            break;
+        default:
+            printf("Insufficient balance or invalid amount!\n");
     }
 }
 
 
 void checkBalance(struct Account *acc) {
-    printf("Your current checking balance is: $%.2f\n", acc->checkingBalance);
-    printf("Your current savings balance is: $%.2f\n", acc->savingsBalance);
+    atmCheckBalance(engine, acc);
+    printf("Your current checking balance is: $%.2f\n", acc->checkingBalance / 100.0);
+    printf("Your current savings balance is: $%.2f\n", acc->savingsBalance / 100.0);
 }
 
+// Interest accrues on every access; this just brings it up to date now.
 void applyInterest(struct Account *acc) {
-    float interestRate = 0.02; 
-    acc->checkingBalance += acc->checkingBalance * interestRate;
-    printf("Interest applied! New checking balance: $%.2f\n", acc->checkingBalance);
+    int64_t credited;
+    atmApplyInterest(engine, acc, &credited);
+    printf("Interest applied at %.2f%% a year! Credited $%.2f, new checking balance: $%.2f\n",
+           interestRateBps(acc->rateTier) / 100.0, credited / 100.0, acc->checkingBalance / 100.0);
 }
 
 
@@ -309,95 +334,169 @@ void changePin(struct Account *acc) {
         do {
             printf("Enter new PIN: ");
             getSecureInput(newPin, 10);
-            if (strlen(newPin) != 4 || strspn(newPin, "0123456789") != 4) {
+            if (!atmValidPin(newPin)) {
                 printf("Invalid PIN! Please enter exactly 4 digits.\n");
             }
-        } while (strlen(newPin) != 4 || strspn(newPin, "0123456789") != 4);
+        } while (!atmValidPin(newPin));
 
-        strcpy(acc->pin, newPin);
-        updateAccount(acc);
-        printf("PIN changed successfully!\n");
+        enum AtmStatus status = atmChangePin(engine, acc, currentPin, newPin);
+        if (status == ATM_OK) {
+            printf("PIN changed successfully!\n");
+        } else {
+            printf("%s!\n", atmStatusMessage(status));
+        }
     } else {
         printf("Incorrect current PIN!\n");
     }
 }
 
 
-void updateAccount(struct Account *acc) {
-    struct Account temp;
-    FILE *file = fopen(FILE_NAME, "r+");
-    if (file == NULL) {
-        printf("Error accessing account records!\n");
-        return;
+// Returns 1 if the account was deleted, which ends the session.
+int deleteAccount(char *accountNumber) {
+    if (atmDeleteAccount(engine, accountNumber) == ATM_OK) {
+        printf("Account deleted successfully.\n");
+        return 1;
     }
-
-    while (fread(&temp, sizeof(struct Account), 1, file)) {
-        if (strcmp(temp.accountNumber, acc->accountNumber) == 0) {
-            fseek(file, -sizeof(struct Account), SEEK_CUR);
-            fwrite(acc, sizeof(struct Account), 1, file);
-            break;
-        }
-    }
-
-    fclose(file);
+    printf("Error deleting account!\n");
+    return 0;
 }
 
 
-void deleteAccount(char *accountNumber) {
-    struct Account temp;
-    FILE *file = fopen(FILE_NAME, "r+");
-    FILE *tempFile = fopen("temp_accounts.txt", "w");
+// Due standing orders run each time the main menu is shown, including at
+// startup.
+void runStandingOrders() {
+    struct AtmOrderRun run;
 
-    if (file == NULL || tempFile == NULL) {
-        printf("Error deleting account!\n");
-        return;
+    enum AtmStatus status = atmRunDueOrders(engine, &run);
+    if (status != ATM_OK) {
+        printf("Standing orders: %s!\n", atmStatusMessage(status));
     }
-
-    while (fread(&temp, sizeof(struct Account), 1, file)) {
-        if (strcmp(temp.accountNumber, accountNumber) != 0) {
-            fwrite(&temp, sizeof(struct Account), 1, tempFile);
-        }
+    if (run.executed > 0 || run.failed > 0) {
+        printf("Standing orders: %ld run, %ld failed (see security.log).\n", run.executed, run.failed);
     }
+}
 
-    fclose(file);
-    fclose(tempFile);
-    remove(FILE_NAME);
-    rename("temp_accounts.txt", FILE_NAME);
+void standingOrders(struct Account *acc) {
+    int choice;
+    unsigned int id;
+    struct OrderList list;
+    enum AtmStatus status;
 
-    printf("Account deleted successfully.\n");
+    do {
+        printf("\n------ Standing Orders ------\n");
+        printf("1. New Standing Order\n");
+        printf("2. List Standing Orders\n");
+        printf("3. Cancel Standing Order\n");
+        printf("4. Back\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        getchar();
+
+        switch(choice) {
+            case 1:
+                newStandingOrder(acc);
+                break;
+            case 2:
+                list.accountNumber = acc->accountNumber;
+                list.shown = 0;
+                status = atmListOrders(engine, acc->accountNumber, printOrder, &list);
+                if (status != ATM_OK) {
+                    printf("%s!\n", atmStatusMessage(status));
+                } else {
+                    printf("%d standing order(s).\n", list.shown);
+                }
+                break;
+            case 3:
+                printf("Order number to cancel: ");
+                scanf("%u", &id);
+                getchar();
+                status = atmCancelOrder(engine, acc->accountNumber, id);
+                if (status == ATM_OK) {
+                    printf("Standing order cancelled.\n");
+                } else {
+                    printf("%s!\n", atmStatusMessage(status));
+                }
+                break;
+            case 4:
+                break;
+            default:
+                printf("Invalid choice! Try again.\n");
+        }
+    } while(choice != 4);
 }
 
+void newStandingOrder(struct Account *acc) {
+    struct StandingOrder order;
+    int kind, every, startIn;
+    double input;
 
-void logTransaction(struct Transaction trans) {
-    FILE *logFile = fopen("transactions.log", "a");
-    if (logFile != NULL) {
-        fprintf(logFile, "%s %.2f %s", trans.type, trans.amount, ctime(&trans.timestamp));
-        fclose(logFile);
-    }
-}
+    memset(&order, 0, sizeof(order));
+    strcpy(order.accountNumber, acc->accountNumber);
 
-//Chat GPT
-void logSecurityEvent(const char *eventDescription) {
-    FILE *logFile = fopen("security.log", "a");
-    if (logFile == NULL) {
-        perror("Error opening security log file");
-        return;
+    printf("1. Deposit  2. Withdrawal  3. Transfer\n");
+    printf("Order type: ");
+    scanf("%d", &kind);
+    getchar();
+    order.kind = kind >= ORDER_DEPOSIT && kind <= ORDER_TRANSFER ? (uint8_t)kind : 0;
+
+    if (order.kind == ORDER_TRANSFER) {
+        printf("Transfer to account: ");
+        scanf("%19s", order.targetAccount);
+        getchar();
     }
 
-    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(logFile));
-    LockFile(hFile, 0, 0, 1, 0);  // Lock file
+    printf("Amount: ");
+    scanf("%lf", &input);
+    getchar();
+    order.amount = input > 0 ? (int64_t)(input * 100.0 + 0.5) : 0;
 
-    time_t currentTime = time(NULL);
-    struct tm *timeInfo = localtime(&currentTime);
-    char timeStr[20];
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeInfo);
+    printf("Repeat every how many days (0 = once): ");
+    scanf("%d", &every);
+    getchar();
+    printf("Start in how many days (0 = today): ");
+    scanf("%d", &startIn);
+    getchar();
+    order.interval = every > 0 ? (uint32_t)every * 86400u : 0;
+    order.nextRun = startIn > 0 ? (uint32_t)(time(NULL) + (time_t)startIn * 86400) : 0;
 
-    fprintf(logFile, "%s - %s\n", timeStr, eventDescription);
+    enum AtmStatus status = atmScheduleOrder(engine, &order);
+    if (status == ATM_OK) {
+        printf("Standing order %u created.\n", order.id);
+    } else {
+        printf("%s!\n", atmStatusMessage(status));
+    }
+}
 
-    UnlockFile(hFile, 0, 0, 1, 0);  // Unlock file
-    fclose(logFile);
+int printOrder(const struct StandingOrder *order, void *context) {
+    struct OrderList *list = context;
+    char timeStr[20];
+    time_t when = (time_t)order->nextRun;
+
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M", localtime(&when));
+    printf("#%-6u ", order->id);
+    if (order->kind == ORDER_TRANSFER && strcmp(order->accountNumber, list->accountNumber) != 0) {
+        printf("Transfer $%.2f from %s", order->amount / 100.0, order->accountNumber);
+    } else if (order->kind == ORDER_TRANSFER) {
+        printf("Transfer $%.2f to %s", order->amount / 100.0, order->targetAccount);
+    } else {
+        printf("%s $%.2f", order->kind == ORDER_DEPOSIT ? "Deposit" : "Withdrawal", order->amount / 100.0);
+    }
+    if (order->interval > 0) {
+        printf(" every %u day(s)", order->interval / 86400u);
+    }
+    printf(", next %s\n", timeStr);
+
+    list->shown++;
+    return 1;
 }
 
+void logout(struct Account *acc) {
+    enum AtmStatus status = atmRefreshAccount(engine, acc);
+    if (status != ATM_OK && status != ATM_ERROR_NOT_FOUND) {
+        printf("%s!\n", atmStatusMessage(status));
+    }
+    printf("Logging out...\n");
+}
 
 void getSecureInput(char *input, int length) {
     int i = 0;
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "scheduler.h"
+
+#define SCHEDULE_BLOCK 512           // records per read or compaction write
+#define COMPACT_MIN_RECORDS 1024     // logs shorter than this are never compacted
+
+static long scheduleOffset(uint32_t index) {
+    return (long)sizeof(struct ScheduleHeader) + (long)index * (long)sizeof(struct StandingOrder);
+}
+
+static int readScheduleHeader(FILE *file, struct ScheduleHeader *header) {
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(header, sizeof(struct ScheduleHeader), 1, file) != 1) {
+        return 0;
+    }
+    return memcmp(header->magic, SCHEDULE_FILE_MAGIC, sizeof(header->magic)) == 0
+        && header->version == SCHEDULE_LAYOUT_VERSION
+        && header->recordSize == SCHEDULE_RECORD_SIZE;
+}
+
+// Rewrites the header, committing everything written before it.
+static int writeScheduleHeader(FILE *file, const struct ScheduleHeader *header) {
+    return fseek(file, 0, SEEK_SET) == 0
+        && fwrite(header, sizeof(struct ScheduleHeader), 1, file) == 1
+        && fflush(file) == 0;
+}
+
+static int reserveOrders(struct Scheduler *scheduler, uint32_t count) {
+    uint32_t capacity = scheduler->capacity > 0 ? scheduler->capacity : 1024;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    struct StandingOrder *orders = realloc(scheduler->orders, (size_t)capacity * sizeof(struct StandingOrder));
+    if (orders == NULL) {
+        return 0;
+    }
+    memset(orders + scheduler->capacity, 0, (size_t)(capacity - scheduler->capacity) * sizeof(struct StandingOrder));
+    scheduler->orders = orders;
+    scheduler->capacity = capacity;
+    return wheelReserve(&scheduler->wheel, (int32_t)capacity);
+}
+
+// Makes a record the current state of its order and arms or disarms the
+// order's timer to match.
+static int applyOrder(struct Scheduler *scheduler, const struct StandingOrder *order) {
+    if (order->id == 0 || order->id > INT32_MAX) {
+        return 1;
+    }
+    if (order->id > scheduler->capacity && !reserveOrders(scheduler, order->id)) {
+        return 0;
+    }
+
+    struct StandingOrder *current = &scheduler->orders[order->id - 1];
+    int32_t timer = (int32_t)(order->id - 1);
+
+    if (current->state == ORDER_ACTIVE) {
+        scheduler->liveCount--;
+        wheelCancel(&scheduler->wheel, timer);
+    }
+    *current = *order;
+    if (order->state == ORDER_ACTIVE) {
+        scheduler->liveCount++;
+        wheelArm(&scheduler->wheel, timer, order->nextRun);
+    }
+    if (order->id > scheduler->orderCount) {
+        scheduler->orderCount = order->id;
+    }
+    return 1;
+}
+
+// Forgets every order, keeping the allocations.
+static void resetOrders(struct Scheduler *scheduler) {
+    for (uint32_t i = 0; i < scheduler->orderCount; i++) {
+        wheelCancel(&scheduler->wheel, (int32_t)i);
+    }
+    if (scheduler->orders != NULL) {
+        memset(scheduler->orders, 0, (size_t)scheduler->orderCount * sizeof(struct StandingOrder));
+    }
+    scheduler->orderCount = 0;
+    scheduler->liveCount = 0;
+    scheduler->appliedCount = 0;
+}
+
+int openScheduler(struct Scheduler *scheduler, const char *path, int64_t now) {
+    memset(scheduler, 0, sizeof(struct Scheduler));
+    initTimerWheel(&scheduler->wheel, now);
+
+    scheduler->file = fopen(path, "r+b");
+    int created = scheduler->file == NULL && errno == ENOENT;
+    if (created) {
+        scheduler->file = fopen(path, "w+b");
+    }
+    if (scheduler->file == NULL) {
+        return 0;
+    }
+
+    // Other processes append between our reads, so no stdio read buffer.
+    // This has to be set before the stream is first read or written.
+    setvbuf(scheduler->file, NULL, _IONBF, 0);
+    if (created) {
+        memcpy(scheduler->header.magic, SCHEDULE_FILE_MAGIC, sizeof(scheduler->header.magic));
+        scheduler->header.version = SCHEDULE_LAYOUT_VERSION;
+        scheduler->header.recordSize = SCHEDULE_RECORD_SIZE;
+        writeScheduleHeader(scheduler->file, &scheduler->header);
+    }
+    if (!readScheduleHeader(scheduler->file, &scheduler->header)) {
+        closeScheduler(scheduler);
+        return 0;
+    }
+    return 1;
+}
+
+void closeScheduler(struct Scheduler *scheduler) {
+    if (scheduler->file != NULL) {
+        fclose(scheduler->file);
+        scheduler->file = NULL;
+    }
+    free(scheduler->orders);
+    scheduler->orders = NULL;
+    scheduler->capacity = 0;
+    scheduler->orderCount = 0;
+    freeTimerWheel(&scheduler->wheel);
+}
+
+// Brings the in-memory orders up to date with the log. Only records added
+// since the last call are read unless the log was compacted meanwhile.
+int syncScheduler(struct Scheduler *scheduler) {
+    struct StandingOrder block[SCHEDULE_BLOCK];
+    uint32_t generation = scheduler->header.generation;
+
+    if (!readScheduleHeader(scheduler->file, &scheduler->header)) {
+        return 0;
+    }
+    if (scheduler->header.generation != generation || scheduler->header.recordCount < scheduler->appliedCount) {
+        resetOrders(scheduler);
+    }
+
+    while (scheduler->appliedCount < scheduler->header.recordCount) {
+        uint32_t wanted = scheduler->header.recordCount - scheduler->appliedCount;
+        if (wanted > SCHEDULE_BLOCK) {
+            wanted = SCHEDULE_BLOCK;
+        }
+        if (fseek(scheduler->file, scheduleOffset(scheduler->header.firstRecord + scheduler->appliedCount), SEEK_SET) != 0
+            || fread(block, sizeof(struct StandingOrder), wanted, scheduler->file) != wanted) {
+            return 0;
+        }
+        for (uint32_t i = 0; i < wanted; i++) {
+            if (!applyOrder(scheduler, &block[i])) {
+                return 0;
+            }
+        }
+        scheduler->appliedCount += wanted;
+    }
+    return 1;
+}
+
+// Writes an order's new state after the end of the log and applies it. The
+// record only becomes part of the log when commitOrders writes the header.
+int appendOrder(struct Scheduler *scheduler, const struct StandingOrder *order) {
+    uint32_t index = scheduler->header.firstRecord + scheduler->header.recordCount;
+
+    if (fseek(scheduler->file, scheduleOffset(index), SEEK_SET) != 0
+        || fwrite(order, sizeof(struct StandingOrder), 1, scheduler->file) != 1) {
+        return 0;
+    }
+    scheduler->header.recordCount++;
+    scheduler->appliedCount++;
+    return applyOrder(scheduler, order);
+}
+
+int commitOrders(struct Scheduler *scheduler) {
+    return writeScheduleHeader(scheduler->file, &scheduler->header);
+}
+
+// Rewrites the log as one record per active order once superseded records
+// and tombstones make up most of it. The copy goes before the current log if
+// it fits there, otherwise after it, so a crash at any point leaves the old
+// log intact. The file does not shrink; later appends reuse the space.
+int compactScheduler(struct Scheduler *scheduler) {
+    struct StandingOrder block[SCHEDULE_BLOCK];
+    struct ScheduleHeader header = scheduler->header;
+    int filled = 0;
+
+    if (header.recordCount < COMPACT_MIN_RECORDS || header.recordCount <= 2 * scheduler->liveCount) {
+        return 1;
+    }
+
+    header.firstRecord = scheduler->liveCount <= header.firstRecord ? 0 : header.firstRecord + header.recordCount;
+    header.recordCount = 0;
+    header.generation++;
+
+    for (uint32_t i = 0; i <= scheduler->orderCount; i++) {
+        if (filled == SCHEDULE_BLOCK || (i == scheduler->orderCount && filled > 0)) {
+            if (fseek(scheduler->file, scheduleOffset(header.firstRecord + header.recordCount), SEEK_SET) != 0
+                || fwrite(block, sizeof(struct StandingOrder), filled, scheduler->file) != (size_t)filled) {
+                return 0;
+            }
+            header.recordCount += filled;
+            filled = 0;
+        }
+        if (i < scheduler->orderCount && scheduler->orders[i].state == ORDER_ACTIVE) {
+            block[filled++] = scheduler->orders[i];
+        }
+    }
+
+    if (!writeScheduleHeader(scheduler->file, &header)) {
+        return 0;
+    }
+    scheduler->header = header;
+    scheduler->appliedCount = header.recordCount;
+    return 1;
+}
+
+const struct StandingOrder *findOrder(const struct Scheduler *scheduler, uint32_t id) {
+    if (id == 0 || id > scheduler->orderCount || scheduler->orders[id - 1].id != id) {
+        return NULL;
+    }
+    return &scheduler->orders[id - 1];
+}
+
+// Returns an active order whose run time has come, taking it off the wheel,
+// or NULL once none is due. The caller appends the order's next state.
+const struct StandingOrder *nextDueOrder(struct Scheduler *scheduler, int64_t now) {
+    wheelAdvance(&scheduler->wheel, now);
+
+    int32_t timer = wheelPopExpired(&scheduler->wheel);
+    return timer >= 0 ? &scheduler->orders[timer] : NULL;
+}
@@ -0,0 +1,83 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "timer_wheel.h"
+
+#define SCHEDULE_FILE_NAME "schedules.dat"
+
+// On-disk layout of SCHEDULE_FILE_NAME:
+//   [ScheduleHeader: 64 bytes][StandingOrder: 64 bytes] * n
+// Records firstRecord .. firstRecord + recordCount - 1 are the log; every
+// change to an order (created, run, cancelled) appends the order's full new
+// state and the last record for an id wins. Finished and cancelled orders
+// stay as tombstones until compaction copies the live orders to free space
+// outside the log and switches the header to them, so the header write is
+// the only commit point for both appends and compaction. Compaction bumps
+// generation so other processes reload instead of reading on.
+#define SCHEDULE_FILE_MAGIC "ATMS"
+#define SCHEDULE_LAYOUT_VERSION 1
+#define SCHEDULE_RECORD_SIZE 64
+
+enum OrderKind {
+    ORDER_DEPOSIT = 1,           // credit accountNumber
+    ORDER_WITHDRAWAL,            // debit accountNumber
+    ORDER_TRANSFER               // debit accountNumber, credit targetAccount
+};
+
+enum OrderState {
+    ORDER_ACTIVE = 1,
+    ORDER_FINISHED,              // one-off order that has run
+    ORDER_CANCELLED
+};
+
+struct StandingOrder {
+    uint32_t id;                 // offset 0, numbered from 1
+    uint8_t kind;                // offset 4, enum OrderKind
+    uint8_t state;               // offset 5, enum OrderState
+    uint16_t reserved0;          // offset 6
+    char accountNumber[20];      // offset 8, NUL padded
+    char targetAccount[20];      // offset 28, NUL padded, transfers only
+    int64_t amount;              // offset 48, cents
+    uint32_t nextRun;            // offset 56, seconds since the epoch
+    uint32_t interval;           // offset 60, seconds between runs, 0 = run once
+};
+
+struct ScheduleHeader {
+    char magic[4];               // SCHEDULE_FILE_MAGIC, not NUL terminated
+    uint32_t version;            // SCHEDULE_LAYOUT_VERSION
+    uint32_t recordSize;         // SCHEDULE_RECORD_SIZE
+    uint32_t firstRecord;
+    uint32_t recordCount;
+    uint32_t generation;         // bumped by every compaction
+    uint8_t reserved[40];
+};
+
+_Static_assert(sizeof(struct StandingOrder) == SCHEDULE_RECORD_SIZE, "StandingOrder must be one 64-byte record");
+_Static_assert(sizeof(struct ScheduleHeader) == SCHEDULE_RECORD_SIZE, "ScheduleHeader must be 64 bytes");
+
+// In-memory view of the log: the latest state of every order, indexed by
+// id - 1, with each active order armed in the timer wheel at its next run.
+// The caller serialises access to the file between processes.
+struct Scheduler {
+    FILE *file;
+    struct ScheduleHeader header;
+    uint32_t appliedCount;       // log records reflected in orders
+    struct StandingOrder *orders;
+    uint32_t orderCount;         // highest id seen
+    uint32_t capacity;
+    uint32_t liveCount;          // active orders
+    struct TimerWheel wheel;
+};
+
+int openScheduler(struct Scheduler *scheduler, const char *path, int64_t now);
+void closeScheduler(struct Scheduler *scheduler);
+int syncScheduler(struct Scheduler *scheduler);
+int appendOrder(struct Scheduler *scheduler, const struct StandingOrder *order);
+int commitOrders(struct Scheduler *scheduler);
+int compactScheduler(struct Scheduler *scheduler);
+const struct StandingOrder *findOrder(const struct Scheduler *scheduler, uint32_t id);
+const struct StandingOrder *nextDueOrder(struct Scheduler *scheduler, int64_t now);
+
+#endif
@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+#include "timer_wheel.h"
+
+#define LEVEL_SHIFT(level) (WHEEL_BITS * (level))
+#define SLOT_MASK (WHEEL_SIZE - 1)
+
+int initTimerWheel(struct TimerWheel *wheel, int64_t now) {
+    memset(wheel, 0, sizeof(struct TimerWheel));
+    memset(wheel->heads, -1, sizeof(wheel->heads));
+    wheel->now = now;
+    return 1;
+}
+
+void freeTimerWheel(struct TimerWheel *wheel) {
+    free(wheel->timers);
+    wheel->timers = NULL;
+    wheel->capacity = 0;
+    wheel->pending = 0;
+}
+
+// Grows the timer table so timers 0..capacity-1 can be armed.
+int wheelReserve(struct TimerWheel *wheel, int32_t capacity) {
+    if (capacity <= wheel->capacity) {
+        return 1;
+    }
+
+    struct WheelTimer *timers = realloc(wheel->timers, (size_t)capacity * sizeof(struct WheelTimer));
+    if (timers == NULL) {
+        return 0;
+    }
+    for (int32_t i = wheel->capacity; i < capacity; i++) {
+        timers[i].expires = 0;
+        timers[i].next = -1;
+        timers[i].prev = -1;
+        timers[i].list = -1;
+    }
+    wheel->timers = timers;
+    wheel->capacity = capacity;
+    return 1;
+}
+
+// Picks the list for an expiry: the finest level whose span still reaches it,
+// indexed by the expiry's own bits at that level.
+static int32_t listFor(const struct TimerWheel *wheel, int64_t expires) {
+    int64_t delta = expires - wheel->now;
+
+    if (delta <= 0) {
+        return WHEEL_EXPIRED;
+    }
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (delta < (1LL << LEVEL_SHIFT(level + 1))) {
+            return level * WHEEL_SIZE + (int32_t)((expires >> LEVEL_SHIFT(level)) & SLOT_MASK);
+        }
+    }
+
+    // Out of range: park in the furthest top-level slot. Its cascade places
+    // the timer again from its real expiry.
+    int64_t parked = wheel->now + (1LL << LEVEL_SHIFT(WHEEL_LEVELS)) - 1;
+    return (WHEEL_LEVELS - 1) * WHEEL_SIZE + (int32_t)((parked >> LEVEL_SHIFT(WHEEL_LEVELS - 1)) & SLOT_MASK);
+}
+
+static void linkTimer(struct TimerWheel *wheel, int32_t timer, int32_t list) {
+    struct WheelTimer *entry = &wheel->timers[timer];
+
+    entry->list = list;
+    entry->prev = -1;
+    entry->next = wheel->heads[list];
+    if (entry->next >= 0) {
+        wheel->timers[entry->next].prev = timer;
+    }
+    wheel->heads[list] = timer;
+    if (list != WHEEL_EXPIRED) {
+        wheel->pending++;
+    }
+}
+
+static void unlinkTimer(struct TimerWheel *wheel, int32_t timer) {
+    struct WheelTimer *entry = &wheel->timers[timer];
+
+    if (entry->prev >= 0) {
+        wheel->timers[entry->prev].next = entry->next;
+    } else {
+        wheel->heads[entry->list] = entry->next;
+    }
+    if (entry->next >= 0) {
+        wheel->timers[entry->next].prev = entry->prev;
+    }
+    if (entry->list != WHEEL_EXPIRED) {
+        wheel->pending--;
+    }
+    entry->list = -1;
+    entry->next = -1;
+    entry->prev = -1;
+}
+
+// Arms or re-arms a timer. An expiry at or before the wheel's time makes it
+// due straight away.
+void wheelArm(struct TimerWheel *wheel, int32_t timer, int64_t expires) {
+    if (wheel->timers[timer].list >= 0) {
+        unlinkTimer(wheel, timer);
+    }
+    wheel->timers[timer].expires = expires;
+    linkTimer(wheel, timer, listFor(wheel, expires));
+}
+
+void wheelCancel(struct TimerWheel *wheel, int32_t timer) {
+    if (timer < wheel->capacity && wheel->timers[timer].list >= 0) {
+        unlinkTimer(wheel, timer);
+    }
+}
+
+// Detaches a whole slot and files each timer again relative to the current
+// time, which moves it down a level or onto the expired list.
+static void cascade(struct TimerWheel *wheel, int32_t list) {
+    int32_t timer = wheel->heads[list];
+
+    wheel->heads[list] = -1;
+    while (timer >= 0) {
+        struct WheelTimer *entry = &wheel->timers[timer];
+        int32_t next = entry->next;
+        wheel->pending--;
+        linkTimer(wheel, timer, listFor(wheel, entry->expires));
+        timer = next;
+    }
+}
+
+// Moves the wheel forward to now. Timers that come due are moved to the
+// expired list for wheelPopExpired.
+void wheelAdvance(struct TimerWheel *wheel, int64_t now) {
+    while (wheel->now < now) {
+        if (wheel->pending == 0) {
+            wheel->now = now;
+            break;
+        }
+
+        int64_t tick = ++wheel->now;
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if ((tick & ((1LL << LEVEL_SHIFT(level)) - 1)) != 0) {
+                break;
+            }
+            cascade(wheel, level * WHEEL_SIZE + (int32_t)((tick >> LEVEL_SHIFT(level)) & SLOT_MASK));
+        }
+        cascade(wheel, (int32_t)(tick & SLOT_MASK));
+    }
+}
+
+// Returns a due timer, now disarmed, or -1 if none is due.
+int32_t wheelPopExpired(struct TimerWheel *wheel) {
+    int32_t timer = wheel->heads[WHEEL_EXPIRED];
+    if (timer >= 0) {
+        unlinkTimer(wheel, timer);
+    }
+    return timer;
+}
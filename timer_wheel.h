@@ -0,0 +1,41 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// Hierarchical timing wheel over timers numbered 0..capacity-1 by the caller.
+// Level 0 has one slot per second and each level above has slots WHEEL_SIZE
+// times wider, so four levels of 64 cover about 194 days; later expiries are
+// parked in the top level and re-placed as they come into range. Arming,
+// cancelling and firing a timer are O(1) whatever the number pending.
+// Advancing costs one step per elapsed second plus a cascade of one slot each
+// time a higher level turns over.
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+#define WHEEL_EXPIRED (WHEEL_LEVELS * WHEEL_SIZE)   // list of timers that are due
+
+struct WheelTimer {
+    int64_t expires;             // seconds since the epoch
+    int32_t next;                // -1 ends the list
+    int32_t prev;                // -1 = first in its list
+    int32_t list;                // slot list index or WHEEL_EXPIRED, -1 = not armed
+};
+
+struct TimerWheel {
+    int64_t now;                 // every timer expiring at or before this is due
+    int32_t heads[WHEEL_EXPIRED + 1];
+    struct WheelTimer *timers;
+    int32_t capacity;
+    int32_t pending;             // armed and not yet due
+};
+
+int initTimerWheel(struct TimerWheel *wheel, int64_t now);
+void freeTimerWheel(struct TimerWheel *wheel);
+int wheelReserve(struct TimerWheel *wheel, int32_t capacity);
+void wheelArm(struct TimerWheel *wheel, int32_t timer, int64_t expires);
+void wheelCancel(struct TimerWheel *wheel, int32_t timer);
+void wheelAdvance(struct TimerWheel *wheel, int64_t now);
+int32_t wheelPopExpired(struct TimerWheel *wheel);
+
+#endif
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "account_file.h"
+#include "velocity.h"
+
+#define INITIAL_BUCKETS 256
+#define DAY_SECONDS (24 * 60 * 60)
+#define HISTORY_CHUNK 65536            // journal bytes stepped back per probe
+
+static void initWindow(struct SlidingWindow *window, int64_t length) {
+    memset(window, 0, sizeof(struct SlidingWindow));
+    window->slotWidth = length > 0 ? (length + WINDOW_SLOTS - 1) / WINDOW_SLOTS : 1;
+}
+
+// Moves the window forward to now, expiring slots that fell out of it. At
+// most WINDOW_RING slots are cleared however long the account was idle.
+static void advanceWindow(struct SlidingWindow *window, int64_t now) {
+    int64_t slot = now / window->slotWidth;
+    int64_t steps = slot - window->headSlot;
+
+    if (steps <= 0) {
+        return;
+    }
+    if (steps >= WINDOW_RING) {
+        memset(window->amount, 0, sizeof(window->amount));
+        memset(window->count, 0, sizeof(window->count));
+        window->totalAmount = 0;
+        window->totalCount = 0;
+    } else {
+        for (int64_t s = window->headSlot + 1; s <= slot; s++) {
+            int i = (int)(s % WINDOW_RING);
+            window->totalAmount -= window->amount[i];
+            window->totalCount -= window->count[i];
+            window->amount[i] = 0;
+            window->count[i] = 0;
+        }
+    }
+    window->headSlot = slot;
+}
+
+static void addToWindow(struct SlidingWindow *window, int64_t amount, int64_t now) {
+    advanceWindow(window, now);
+
+    // Entries older than the head (replayed history) land in their own slot
+    // if it is still inside the window.
+    int64_t slot = now / window->slotWidth;
+    if (window->headSlot - slot >= WINDOW_RING) {
+        return;
+    }
+
+    int i = (int)(slot % WINDOW_RING);
+    window->amount[i] += amount;
+    window->count[i]++;
+    window->totalAmount += amount;
+    window->totalCount++;
+}
+
+// Returns 0 if out of memory.
+int initVelocityTracker(struct VelocityTracker *tracker) {
+    tracker->bucketCount = INITIAL_BUCKETS;
+    tracker->accountCount = 0;
+    tracker->buckets = calloc(tracker->bucketCount, sizeof(struct AccountVelocity *));
+    return tracker->buckets != NULL;
+}
+
+void freeVelocityTracker(struct VelocityTracker *tracker) {
+    for (int i = 0; i < tracker->bucketCount; i++) {
+        struct AccountVelocity *entry = tracker->buckets[i];
+        while (entry != NULL) {
+            struct AccountVelocity *next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(tracker->buckets);
+    tracker->buckets = NULL;
+    tracker->bucketCount = 0;
+    tracker->accountCount = 0;
+}
+
+static void growTracker(struct VelocityTracker *tracker) {
+    int newCount = tracker->bucketCount * 2;
+    struct AccountVelocity **newBuckets = calloc(newCount, sizeof(struct AccountVelocity *));
+    if (newBuckets == NULL) {
+        return; // keep the longer chains rather than fail a withdrawal
+    }
+
+    for (int i = 0; i < tracker->bucketCount; i++) {
+        struct AccountVelocity *entry = tracker->buckets[i];
+        while (entry != NULL) {
+            struct AccountVelocity *next = entry->next;
+            uint32_t b = hashAccount(entry->accountNumber) & (newCount - 1);
+            entry->next = newBuckets[b];
+            newBuckets[b] = entry;
+            entry = next;
+        }
+    }
+
+    free(tracker->buckets);
+    tracker->buckets = newBuckets;
+    tracker->bucketCount = newCount;
+}
+
+static struct AccountVelocity *findAccount(struct VelocityTracker *tracker, const char *accountNumber, int create) {
+    uint32_t b = hashAccount(accountNumber) & (tracker->bucketCount - 1);
+
+    for (struct AccountVelocity *entry = tracker->buckets[b]; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->accountNumber, accountNumber) == 0) {
+            return entry;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    struct AccountVelocity *entry = calloc(1, sizeof(struct AccountVelocity));
+    if (entry == NULL) {
+        return NULL;
+    }
+    strncpy(entry->accountNumber, accountNumber, sizeof(entry->accountNumber) - 1);
+    initWindow(&entry->day, DAY_SECONDS);
+    initWindow(&entry->burst, VELOCITY_WINDOW);
+    entry->next = tracker->buckets[b];
+    tracker->buckets[b] = entry;
+
+    if (++tracker->accountCount > tracker->bucketCount) {
+        growTracker(tracker);
+    }
+    return entry;
+}
+
+// Decides whether a withdrawal fits the account's rolling daily limits. The
+// account's windows are created here, so recording an approved withdrawal
+// straight afterwards cannot run out of memory.
+enum WithdrawalVerdict checkWithdrawal(struct VelocityTracker *tracker, const char *accountNumber,
+                                       int64_t amount, int64_t now) {
+    struct AccountVelocity *entry = findAccount(tracker, accountNumber, 1);
+    if (entry == NULL) {
+        return WITHDRAWAL_NO_MEMORY;
+    }
+
+    advanceWindow(&entry->day, now);
+    if (entry->day.totalCount + 1 > DAILY_WITHDRAWAL_COUNT) {
+        return WITHDRAWAL_OVER_DAILY_COUNT;
+    }
+    if (entry->day.totalAmount + amount > DAILY_WITHDRAWAL_LIMIT) {
+        return WITHDRAWAL_OVER_DAILY_AMOUNT;
+    }
+    return WITHDRAWAL_OK;
+}
+
+// Adds a completed withdrawal. Returns the number of withdrawals in the
+// burst window if that exceeds VELOCITY_MAX_WITHDRAWALS, otherwise 0, or -1
+// if out of memory.
+int recordWithdrawal(struct VelocityTracker *tracker, const char *accountNumber, int64_t amount, int64_t now) {
+    struct AccountVelocity *entry = findAccount(tracker, accountNumber, 1);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    addToWindow(&entry->day, amount, now);
+    addToWindow(&entry->burst, amount, now);
+    return entry->burst.totalCount > VELOCITY_MAX_WITHDRAWALS ? entry->burst.totalCount : 0;
+}
+
+// Adds the withdrawals journalled from offset up to the last complete line,
+// skipping those at or before since, and moves offset past them. A line
+// without its newline is still being written by another handle and is left
+// for the next call. Lines are "<account> <type> <amount> <epoch> <ctime>";
+// entries in the older format without an account number are skipped.
+// Returns 0 if out of memory, with offset at the line that failed.
+static int replayWithdrawals(struct VelocityTracker *tracker, FILE *journal, long *offset, int64_t since) {
+    char line[256], accountNumber[20], type[16];
+    double amount;
+    long long timestamp;
+
+    if (fseek(journal, *offset, SEEK_SET) != 0) {
+        return 1;
+    }
+    while (fgets(line, sizeof(line), journal)) {
+        size_t length = strlen(line);
+        if (line[length - 1] != '\n' && length < sizeof(line) - 1) {
+            break;
+        }
+        if (sscanf(line, "%19s %15s %lf %lld", accountNumber, type, &amount, &timestamp) == 4
+            && strcmp(type, "Withdrawal") == 0 && timestamp > since
+            && recordWithdrawal(tracker, accountNumber, (int64_t)(amount * 100.0 + 0.5), timestamp) < 0) {
+            return 0;
+        }
+        *offset += (long)length;
+    }
+    return 1;
+}
+
+// Start of a line at or before the journal's first entry after since. Steps
+// back from the end a chunk at a time and reads one line at each step, so a
+// long journal is not read from the beginning. Lines without a timestamp
+// count as old.
+static long findHistoryStart(FILE *journal, int64_t since) {
+    char line[256], accountNumber[20], type[16];
+    double amount;
+    long long timestamp;
+
+    if (fseek(journal, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    for (long pos = ftell(journal) - HISTORY_CHUNK; pos > 0; pos -= HISTORY_CHUNK) {
+        if (fseek(journal, pos, SEEK_SET) != 0 || fgets(line, sizeof(line), journal) == NULL) {
+            return 0;
+        }
+        long lineStart = ftell(journal);
+        if (fgets(line, sizeof(line), journal) == NULL
+            || sscanf(line, "%19s %15s %lf %lld", accountNumber, type, &amount, &timestamp) != 4
+            || timestamp <= since) {
+            return lineStart;
+        }
+    }
+    return 0;
+}
+
+// Seeds the windows with the last day of withdrawals so limits survive a
+// restart, and sets offset to the end of what was read for
+// catchUpVelocity. Returns 0 if out of memory.
+int loadVelocityHistory(struct VelocityTracker *tracker, FILE *journal, long *offset, int64_t now) {
+    *offset = findHistoryStart(journal, now - DAY_SECONDS);
+    return replayWithdrawals(tracker, journal, offset, now - DAY_SECONDS);
+}
+
+// Adds the withdrawals other handles have journalled since offset. Called
+// under the journal lock before a withdrawal is checked, so every terminal
+// enforces the limits on the same totals. Returns 0 if out of memory.
+int catchUpVelocity(struct VelocityTracker *tracker, FILE *journal, long *offset, int64_t now) {
+    return replayWithdrawals(tracker, journal, offset, now - DAY_SECONDS);
+}
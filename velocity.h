@@ -0,0 +1,72 @@
+#ifndef VELOCITY_H
+#define VELOCITY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Streaming per-account withdrawal totals. Each account keeps two sliding
+// windows (the last day and a short burst window) as rings of time slots, so
+// checking and recording a withdrawal is O(1). History is seeded at startup
+// from the tail of the transaction journal, and withdrawals made at other
+// terminals are picked up by reading only the journal lines appended since.
+//
+// Limits can be overridden at compile time, e.g. -DDAILY_WITHDRAWAL_LIMIT=50000.
+#ifndef DAILY_WITHDRAWAL_LIMIT
+#define DAILY_WITHDRAWAL_LIMIT 100000      // cents per rolling 24 hours
+#endif
+#ifndef DAILY_WITHDRAWAL_COUNT
+#define DAILY_WITHDRAWAL_COUNT 10          // withdrawals per rolling 24 hours
+#endif
+#ifndef VELOCITY_WINDOW
+#define VELOCITY_WINDOW 600                // seconds
+#endif
+#ifndef VELOCITY_MAX_WITHDRAWALS
+#define VELOCITY_MAX_WITHDRAWALS 3         // more than this in VELOCITY_WINDOW is flagged
+#endif
+
+#define WINDOW_SLOTS 24
+#define WINDOW_RING (WINDOW_SLOTS + 1)   // the extra slot holds the partly expired one
+
+enum WithdrawalVerdict {
+    WITHDRAWAL_OK,
+    WITHDRAWAL_OVER_DAILY_AMOUNT,
+    WITHDRAWAL_OVER_DAILY_COUNT,
+    WITHDRAWAL_NO_MEMORY
+};
+
+// Totals over at least the last length seconds, kept in slots of
+// length / WINDOW_SLOTS seconds (rounded up). A slot is only cleared once it
+// ended length seconds ago, so an entry counts for between length and
+// length plus one slot, never less: a limit is never enforced over a
+// shorter window than stated.
+struct SlidingWindow {
+    int64_t slotWidth;
+    int64_t headSlot;                  // absolute slot number of the newest slot
+    int64_t amount[WINDOW_RING];
+    int count[WINDOW_RING];
+    int64_t totalAmount;
+    int totalCount;
+};
+
+struct AccountVelocity {
+    char accountNumber[20];
+    struct SlidingWindow day;
+    struct SlidingWindow burst;
+    struct AccountVelocity *next;
+};
+
+struct VelocityTracker {
+    struct AccountVelocity **buckets;
+    int bucketCount;                   // power of two
+    int accountCount;
+};
+
+int initVelocityTracker(struct VelocityTracker *tracker);
+void freeVelocityTracker(struct VelocityTracker *tracker);
+int loadVelocityHistory(struct VelocityTracker *tracker, FILE *journal, long *offset, int64_t now);
+int catchUpVelocity(struct VelocityTracker *tracker, FILE *journal, long *offset, int64_t now);
+enum WithdrawalVerdict checkWithdrawal(struct VelocityTracker *tracker, const char *accountNumber,
+                                       int64_t amount, int64_t now);
+int recordWithdrawal(struct VelocityTracker *tracker, const char *accountNumber, int64_t amount, int64_t now);
+
+#endif